@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+// Minimal harness for dcm_bench. Each benchmark prints one line per
+// measurement: benchmark, case, value, unit.
+namespace Bench {
+
+// Benchmarks fold results in here so the timed work is not optimised away.
+extern volatile quint64 sink;
+
+// Runs fn once to warm up, then repeatedly for at least minMs; returns
+// the mean nanoseconds per call.
+template <typename F>
+double nsPerCall(F&& fn, int minMs = 300)
+{
+    fn();
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 calls = 0;
+    do {
+        fn();
+        ++calls;
+    } while (timer.elapsed() < minMs);
+    return static_cast<double>(timer.nsecsElapsed()) / calls;
+}
+
+void report(const char* benchmark, const char* what, double value, const char* unit);
+
+} // namespace Bench
+
+// One entry point per benchmark file.
+void benchRx();
+void benchLayout();
+void benchSpsc();
+void benchDsp();
+void benchPaint();
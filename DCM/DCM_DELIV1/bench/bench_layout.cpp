@@ -0,0 +1,184 @@
+#include "bench.h"
+#include "framelayout.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace FrameLayout;
+
+// FrameLayout's table-driven get<>/put<> against the same frames coded by
+// hand with literal offsets and shifts, as the builders were written
+// before the field tables existed. Both sides must produce identical bytes.
+namespace {
+
+// ---- Hand-written parameter frame ----
+void handPutU16(quint8* f, int off, quint16 v)
+{
+    f[off]     = static_cast<quint8>(v);
+    f[off + 1] = static_cast<quint8>(v >> 8);
+}
+
+void handPutF32(quint8* f, int off, float v)
+{
+    quint32 raw;
+    std::memcpy(&raw, &v, sizeof(raw));
+    f[off]     = static_cast<quint8>(raw);
+    f[off + 1] = static_cast<quint8>(raw >> 8);
+    f[off + 2] = static_cast<quint8>(raw >> 16);
+    f[off + 3] = static_cast<quint8>(raw >> 24);
+}
+
+quint16 handGetU16(const quint8* f, int off)
+{
+    return static_cast<quint16>(f[off] | (f[off + 1] << 8));
+}
+
+float handGetF32(const quint8* f, int off)
+{
+    const quint32 raw = quint32(f[off]) | (quint32(f[off + 1]) << 8)
+                      | (quint32(f[off + 2]) << 16) | (quint32(f[off + 3]) << 24);
+    float v;
+    std::memcpy(&v, &raw, sizeof(v));
+    return v;
+}
+
+void handEncode(const Database::ModeProfile& p, quint8* f)
+{
+    f[0] = MSG_SET_PARAMS;
+    f[2] = modeToCode(p.mode);
+    f[3] = static_cast<quint8>(p.lrl.value_or(0));
+    f[4] = static_cast<quint8>(p.url.value_or(0));
+    handPutF32(f, 5,  static_cast<float>(p.aAmp.value_or(0.0)));
+    handPutF32(f, 9,  static_cast<float>(p.vAmp.value_or(0.0)));
+    handPutF32(f, 13, static_cast<float>(p.aPw.value_or(0.0)));
+    handPutF32(f, 17, static_cast<float>(p.vPw.value_or(0.0)));
+    handPutU16(f, 21, static_cast<quint16>(p.vrp.value_or(0)));
+    handPutU16(f, 23, static_cast<quint16>(p.arp.value_or(0)));
+    f[25] = 0;
+    handPutU16(f, 26, 0);
+    f[28] = 0;
+}
+
+Database::ModeProfile handDecode(const quint8* f)
+{
+    Database::ModeProfile p;
+    p.userId = -1;
+    p.mode = codeToMode(f[2]);
+    p.lrl  = f[3];
+    p.url  = f[4];
+    p.aAmp = handGetF32(f, 5);
+    p.vAmp = handGetF32(f, 9);
+    p.aPw  = handGetF32(f, 13);
+    p.vPw  = handGetF32(f, 17);
+    p.vrp  = handGetU16(f, 21);
+    p.arp  = handGetU16(f, 23);
+    return p;
+}
+
+// ---- Packed egram frame: the RX hot path ----
+quint64 layoutSamples(const quint8* f)
+{
+    quint64 acc = get<EgramPacked::Counter>(f);
+    const int count = get<EgramPacked::Count>(f);
+    for (int i = 0; i < 2 * count; ++i)
+        acc += static_cast<quint16>(EgramPacked::sample(f, i));
+    return acc;
+}
+
+quint64 handSamples(const quint8* f)
+{
+    quint64 acc = handGetU16(f, 2);
+    const int count = f[4];
+    for (int i = 0; i < 2 * count; ++i)
+        acc += handGetU16(f, 5 + 2 * i);
+    return acc;
+}
+
+Database::ModeProfile profile()
+{
+    Database::ModeProfile p;
+    p.mode = "VVIR";
+    p.lrl  = 60;
+    p.url  = 120;
+    p.aAmp = 3.5;
+    p.vAmp = 3.5;
+    p.aPw  = 0.4;
+    p.vPw  = 0.4;
+    p.vrp  = 320;
+    p.arp  = 250;
+    return p;
+}
+}
+
+void benchLayout()
+{
+    const Database::ModeProfile p = profile();
+
+    // Same bytes either way, or the comparison means nothing.
+    Frame viaLayout;
+    put<Type>(viaLayout.data(), MSG_SET_PARAMS);
+    encodeParameters(p, viaLayout.data());
+    Frame viaHand;
+    handEncode(p, viaHand.data());
+    if (std::memcmp(viaLayout.data(), viaHand.data(), FRAME_SIZE) != 0) {
+        std::printf("layout: hand-written encoder disagrees with FrameLayout\n");
+        std::exit(1);
+    }
+
+    constexpr int N = 1024;
+
+    Bench::report("layout", "encode parameters, FrameLayout",
+                  Bench::nsPerCall([&]() {
+                      for (int i = 0; i < N; ++i) {
+                          Frame f;
+                          put<Type>(f.data(), MSG_SET_PARAMS);
+                          encodeParameters(p, f.data());
+                          Bench::sink = Bench::sink + f.bytes[5 + (i & 15)];
+                      }
+                  }) / N, "ns");
+    Bench::report("layout", "encode parameters, hand-written",
+                  Bench::nsPerCall([&]() {
+                      for (int i = 0; i < N; ++i) {
+                          Frame f;
+                          handEncode(p, f.data());
+                          Bench::sink = Bench::sink + f.bytes[5 + (i & 15)];
+                      }
+                  }) / N, "ns");
+
+    Bench::report("layout", "decode parameters, FrameLayout",
+                  Bench::nsPerCall([&]() {
+                      for (int i = 0; i < N; ++i)
+                          Bench::sink = Bench::sink + static_cast<quint64>(*decodeParameters(viaLayout.data()).vrp);
+                  }) / N, "ns");
+    Bench::report("layout", "decode parameters, hand-written",
+                  Bench::nsPerCall([&]() {
+                      for (int i = 0; i < N; ++i)
+                          Bench::sink = Bench::sink + static_cast<quint64>(*handDecode(viaHand.data()).vrp);
+                  }) / N, "ns");
+
+    // A run of distinct packed frames, so the loop cannot be hoisted.
+    static Frame packed[N];
+    for (int i = 0; i < N; ++i) {
+        put<Type>(packed[i].data(), MSG_EGRAM_PACKED);
+        put<EgramPacked::Counter>(packed[i].data(), static_cast<quint16>(i * EgramPacked::PAIRS_PER_FRAME));
+        put<EgramPacked::Count>(packed[i].data(), EgramPacked::PAIRS_PER_FRAME);
+        for (int k = 0; k < 2 * EgramPacked::PAIRS_PER_FRAME; ++k)
+            EgramPacked::setSample(packed[i].data(), k, static_cast<qint16>(i - k));
+    }
+
+    Bench::report("layout", "decode packed egram frame, FrameLayout",
+                  Bench::nsPerCall([&]() {
+                      quint64 acc = 0;
+                      for (int i = 0; i < N; ++i)
+                          acc += layoutSamples(packed[i].data());
+                      Bench::sink = Bench::sink + acc;
+                  }) / N, "ns");
+    Bench::report("layout", "decode packed egram frame, hand-written",
+                  Bench::nsPerCall([&]() {
+                      quint64 acc = 0;
+                      for (int i = 0; i < N; ++i)
+                          acc += handSamples(packed[i].data());
+                      Bench::sink = Bench::sink + acc;
+                  }) / N, "ns");
+}
@@ -0,0 +1,54 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+struct Benchmark {
+    const char* name;
+    void (*run)();
+    const char* about;
+};
+
+const Benchmark BENCHMARKS[] = {
+    { "rx", benchRx, "serial RX ring and frame decoder, multi-megabyte bursts" },
+    { "layout", benchLayout, "FrameLayout encode/decode against hand-written offsets" },
+    { "spsc", benchSpsc, "egram and marker queues, one thread and two" },
+    { "dsp", benchDsp, "egram filters, FIR kernels and spectrogram FFT, one core" },
+    { "paint", benchPaint, "EgramWidget paint cost on the offscreen platform, before/after" },
+};
+}
+
+volatile quint64 Bench::sink = 0;
+
+void Bench::report(const char* benchmark, const char* what, double value, const char* unit)
+{
+    std::printf("%-8s %-48s %12.2f %s\n", benchmark, what, value, unit);
+    std::fflush(stdout);
+}
+
+// dcm_bench [name...]: runs the named benchmarks, or all of them.
+int main(int argc, char** argv)
+{
+    int ran = 0;
+    for (const Benchmark& b : BENCHMARKS) {
+        bool wanted = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            wanted = wanted || std::strcmp(argv[i], b.name) == 0;
+        if (!wanted)
+            continue;
+
+        std::printf("# %s: %s\n", b.name, b.about);
+        b.run();
+        ++ran;
+    }
+
+    if (ran == 0) {
+        std::fprintf(stderr, "usage: dcm_bench [name...]\nbenchmarks:");
+        for (const Benchmark& b : BENCHMARKS)
+            std::fprintf(stderr, " %s", b.name);
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
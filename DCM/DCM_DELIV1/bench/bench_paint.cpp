@@ -0,0 +1,244 @@
+#include "bench.h"
+#include "egrambuffer.h"
+#include "egramwidget.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QWidget>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// EgramWidget paint cost on the offscreen platform, 1 kHz fed at 60 frames
+// a second into a 1200 x 400 widget, against the strip chart it replaced:
+// min/max columns re-rasterised as a polyline over the whole widget on
+// every paint. Needs no display; the platform is forced to "offscreen"
+// unless QT_QPA_PLATFORM says otherwise.
+namespace {
+constexpr int RATE_HZ = 1000;
+constexpr int FPS = 60;
+constexpr int FRAMES = 600;            // ten seconds of stream
+constexpr int WIDTH = 1200;
+constexpr int HEIGHT = 400;
+constexpr double WINDOW_SEC = 10.0;
+
+constexpr float EMPTY_MIN = std::numeric_limits<float>::max();
+constexpr float EMPTY_MAX = -std::numeric_limits<float>::max();
+
+float egramMv(quint32 i, bool ventricle)
+{
+    const int t = static_cast<int>(i % 800);
+    const int at = ventricle ? 150 : 0;
+    const float wave = 0.2f * static_cast<float>(std::sin(i * 0.02));
+    return t > at && t < at + 12 ? wave + (ventricle ? 3.0f : 1.5f) : wave;
+}
+
+// The pre-backing-image EgramWidget paint: fill, baseline, then one
+// vertical span per column for the whole window.
+class PolylineChart : public QWidget {
+public:
+    PolylineChart()
+    {
+        setAttribute(Qt::WA_OpaquePaintEvent);
+        resize(WIDTH, HEIGHT);
+        m_columns = WIDTH - 2 * MARGIN;
+        m_spc = qMax(1, static_cast<int>(std::lround(WINDOW_SEC * RATE_HZ)) / m_columns);
+        for (Channel& c : m_ch) {
+            c.colMin.assign(static_cast<size_t>(m_columns), EMPTY_MIN);
+            c.colMax.assign(static_cast<size_t>(m_columns), EMPTY_MAX);
+        }
+    }
+
+    void append(const float* a, const float* v, int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            fold(m_ch[0], a[i]);
+            fold(m_ch[1], v[i]);
+            if (++m_inColumn == m_spc) {
+                for (Channel& c : m_ch) {
+                    const size_t slot = m_colsDone % static_cast<quint32>(m_columns);
+                    c.colMin[slot] = c.curMin;
+                    c.colMax[slot] = c.curMax;
+                    c.curMin = EMPTY_MIN;
+                    c.curMax = EMPTY_MAX;
+                }
+                ++m_colsDone;
+                m_inColumn = 0;
+            }
+        }
+    }
+
+    qint64 lastPaintNs{0};
+
+protected:
+    void paintEvent(QPaintEvent*) override
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        QPainter p(this);
+        p.fillRect(rect(), Qt::white);
+        const int half = height() / 2;
+        draw(p, m_ch[0], 0, half, Qt::red);
+        draw(p, m_ch[1], half, height() - half, Qt::blue);
+
+        lastPaintNs = timer.nsecsElapsed();
+    }
+
+private:
+    static constexpr int MARGIN = 10;
+
+    struct Channel {
+        std::vector<float> colMin, colMax;
+        float curMin{EMPTY_MIN};
+        float curMax{EMPTY_MAX};
+    };
+
+    static void fold(Channel& c, float x)
+    {
+        c.curMin = qMin(c.curMin, x);
+        c.curMax = qMax(c.curMax, x);
+    }
+
+    void draw(QPainter& p, const Channel& c, int top, int h, const QColor& color)
+    {
+        const double mid = top + h / 2.0;
+        const double scale = (h / 2.0 - 2.0) / 5.0;
+        const int right = width() - MARGIN;
+
+        p.setPen(QPen(Qt::gray, 1, Qt::DashLine));
+        p.drawLine(MARGIN, static_cast<int>(mid), right, static_cast<int>(mid));
+
+        m_lines.clear();
+        for (int i = m_columns; i >= 1; --i) {
+            if (static_cast<quint32>(i) > m_colsDone)
+                continue;
+            const size_t slot = (m_colsDone - static_cast<quint32>(i)) % static_cast<quint32>(m_columns);
+            const double x = right - i;
+            const double y0 = mid - c.colMax[slot] * scale;
+            m_lines.emplace_back(x, y0, x, qMax(mid - c.colMin[slot] * scale, y0 + 1.0));
+        }
+        p.setPen(QPen(color, 1));
+        p.drawLines(m_lines.data(), static_cast<int>(m_lines.size()));
+    }
+
+    Channel m_ch[2];
+    std::vector<QLineF> m_lines;
+    int     m_columns;
+    int     m_spc;
+    int     m_inColumn{0};
+    quint32 m_colsDone{0};
+};
+
+// Fills one frame's worth of samples, continuing from *next.
+void makeFrame(quint32* next, std::vector<quint32>& t, std::vector<float>& a, std::vector<float>& v)
+{
+    const int n = static_cast<int>(t.size());
+    for (int i = 0; i < n; ++i, ++*next) {
+        t[static_cast<size_t>(i)] = *next;
+        a[static_cast<size_t>(i)] = egramMv(*next, false);
+        v[static_cast<size_t>(i)] = egramMv(*next, true);
+    }
+}
+
+// EgramWidget in the given mode. With incremental set, each frame goes
+// through the widget's own tick (drain, render new columns, update() the
+// dirty rect) and the paint that follows; otherwise the whole widget is
+// repainted every frame. Returns microseconds per paint, as the widget
+// measures them itself.
+double widgetPaintUs(EgramWidget::DisplayMode mode, bool incremental, double* tickUs)
+{
+    EgramBuffer queue(4096);
+    EgramWidget w;
+    w.setSource(&queue);
+    w.setSampleRate(RATE_HZ);
+    w.setTimeWindow(WINDOW_SEC);
+    w.setDisplayMode(mode);
+    w.setUnthrottled(true);
+    w.resize(WIDTH, HEIGHT);
+    w.show();
+    QApplication::processEvents();
+
+    std::vector<quint32> t(RATE_HZ / FPS);
+    std::vector<float> a(t.size()), v(t.size());
+    quint32 next = 0;
+
+    // One frame of samples, then the tick and the paint it asks for.
+    auto frame = [&]() {
+        makeFrame(&next, t, a, v);
+        queue.pushBlock(t.data(), a.data(), v.data(), static_cast<int>(t.size()));
+        w.dataAvailable();
+        QApplication::processEvents();
+        QApplication::processEvents();
+    };
+
+    // Fill the window first so every column has a trace in it.
+    for (int f = 0; f < static_cast<int>(WINDOW_SEC) * FPS; ++f)
+        frame();
+
+    qint64 fullUs = 0;
+    for (int f = 0; f < FRAMES; ++f) {
+        frame();
+        if (!incremental) {
+            w.repaint();
+            fullUs += w.lastPaintUs();
+        }
+    }
+    *tickUs = w.averageTickUs();
+    return incremental ? w.averagePaintUs() : static_cast<double>(fullUs) / FRAMES;
+}
+
+double polylinePaintUs()
+{
+    PolylineChart w;
+    w.show();
+    QApplication::processEvents();
+
+    std::vector<quint32> t(RATE_HZ / FPS);
+    std::vector<float> a(t.size()), v(t.size());
+    quint32 next = 0;
+    for (int f = 0; f < static_cast<int>(WINDOW_SEC) * FPS; ++f) {
+        makeFrame(&next, t, a, v);
+        w.append(a.data(), v.data(), static_cast<int>(t.size()));
+    }
+
+    qint64 paintNs = 0;
+    for (int f = 0; f < FRAMES; ++f) {
+        makeFrame(&next, t, a, v);
+        w.append(a.data(), v.data(), static_cast<int>(t.size()));
+        w.repaint();
+        paintNs += w.lastPaintNs;
+    }
+    return paintNs / 1e3 / FRAMES;
+}
+}
+
+void benchPaint()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    std::unique_ptr<QApplication> app;
+    if (!QApplication::instance()) {
+        static int argc = 1;
+        static char name[] = "dcm_bench";
+        static char* argv[] = { name, nullptr };
+        app = std::make_unique<QApplication>(argc, argv);
+    }
+
+    double tickUs = 0.0;
+    Bench::report("paint", "polyline, full repaint (before)", polylinePaintUs(), "us/frame");
+    Bench::report("paint", "scroll, full repaint",
+                  widgetPaintUs(EgramWidget::DisplayMode::Scroll, false, &tickUs), "us/frame");
+    Bench::report("paint", "scroll, dirty rect",
+                  widgetPaintUs(EgramWidget::DisplayMode::Scroll, true, &tickUs), "us/frame");
+    Bench::report("paint", "scroll, tick (drain + new columns)", tickUs, "us/frame");
+    Bench::report("paint", "sweep, full repaint",
+                  widgetPaintUs(EgramWidget::DisplayMode::Sweep, false, &tickUs), "us/frame");
+    Bench::report("paint", "sweep, dirty rect",
+                  widgetPaintUs(EgramWidget::DisplayMode::Sweep, true, &tickUs), "us/frame");
+    Bench::report("paint", "sweep, tick (drain + new columns)", tickUs, "us/frame");
+}
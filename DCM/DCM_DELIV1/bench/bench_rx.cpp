@@ -0,0 +1,118 @@
+#include "bench.h"
+#include "framelayout.h"
+#include "ringbuffer.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace FrameLayout;
+
+// The RX path of PacemakerLink::handleReadyRead/processRawFrames, fed from
+// memory instead of a port, against the QByteArray append/left/remove
+// loop it replaced. Each readyRead hands over READ_CHUNK bytes.
+namespace {
+constexpr int RX_CAPACITY = 8192;   // as in PacemakerLink
+constexpr int READ_CHUNK  = 4096;
+
+// Packed egram frames with a running counter and a ramp of samples.
+std::vector<quint8> makeBurst(int bytes)
+{
+    std::vector<quint8> burst(static_cast<size_t>(bytes / FRAME_SIZE * FRAME_SIZE));
+    quint16 counter = 0;
+    for (size_t off = 0; off < burst.size(); off += FRAME_SIZE) {
+        quint8* f = burst.data() + off;
+        put<Type>(f, MSG_EGRAM_PACKED);
+        put<EgramPacked::Counter>(f, counter);
+        put<EgramPacked::Count>(f, EgramPacked::PAIRS_PER_FRAME);
+        for (int i = 0; i < 2 * EgramPacked::PAIRS_PER_FRAME; ++i)
+            EgramPacked::setSample(f, i, static_cast<qint16>(counter + i));
+        counter = static_cast<quint16>(counter + EgramPacked::PAIRS_PER_FRAME);
+    }
+    return burst;
+}
+
+// What handlePackedEgramFrame reads from each frame.
+inline quint64 decode(const quint8* f)
+{
+    quint64 acc = get<Type>(f) + get<EgramPacked::Counter>(f);
+    for (int i = 0; i < 2 * EgramPacked::PAIRS_PER_FRAME; ++i)
+        acc += static_cast<quint16>(EgramPacked::sample(f, i));
+    return acc;
+}
+
+quint64 viaRing(RingBuffer& rx, const std::vector<quint8>& burst)
+{
+    quint64 acc = 0;
+    quint8 scratch[FRAME_SIZE];
+
+    for (size_t pos = 0; pos < burst.size();) {
+        // One readyRead: read straight into free space, decode as we go.
+        size_t pending = std::min<size_t>(READ_CHUNK, burst.size() - pos);
+        while (pending > 0) {
+            int room = 0;
+            quint8* dst = rx.writePtr(&room);
+            const int n = static_cast<int>(std::min<size_t>(static_cast<size_t>(room), pending));
+            std::memcpy(dst, burst.data() + pos, static_cast<size_t>(n));
+            rx.commit(n);
+            pos += static_cast<size_t>(n);
+            pending -= static_cast<size_t>(n);
+
+            while (rx.size() >= FRAME_SIZE) {
+                int len = 0;
+                const quint8* f = rx.readPtr(&len);
+                if (len < FRAME_SIZE) {
+                    rx.peek(0, scratch, FRAME_SIZE);
+                    f = scratch;
+                }
+                acc += decode(f);
+                rx.consume(FRAME_SIZE);
+            }
+        }
+    }
+    return acc;
+}
+
+quint64 viaByteArray(QByteArray& rxBuffer, const std::vector<quint8>& burst)
+{
+    quint64 acc = 0;
+
+    for (size_t pos = 0; pos < burst.size();) {
+        const int n = static_cast<int>(std::min<size_t>(READ_CHUNK, burst.size() - pos));
+        rxBuffer.append(QByteArray(reinterpret_cast<const char*>(burst.data() + pos), n));
+        pos += static_cast<size_t>(n);
+
+        while (rxBuffer.size() >= FRAME_SIZE) {
+            const QByteArray frame = rxBuffer.left(FRAME_SIZE);
+            rxBuffer.remove(0, FRAME_SIZE);
+            acc += decode(reinterpret_cast<const quint8*>(frame.constData()));
+        }
+    }
+    return acc;
+}
+}
+
+void benchRx()
+{
+    for (int mb : { 1, 4, 16 }) {
+        const std::vector<quint8> burst = makeBurst(mb << 20);
+        const double frames = static_cast<double>(burst.size() / FRAME_SIZE);
+        char what[64];
+
+        RingBuffer rx(RX_CAPACITY);
+        const double ringNs = Bench::nsPerCall([&]() { Bench::sink = Bench::sink + viaRing(rx, burst); });
+        std::snprintf(what, sizeof what, "ring, %d MB burst", mb);
+        Bench::report("rx", what, burst.size() / (ringNs / 1e9) / (1 << 20), "MB/s");
+        std::snprintf(what, sizeof what, "ring, %d MB burst, per frame", mb);
+        Bench::report("rx", what, ringNs / frames, "ns");
+
+        QByteArray rxBuffer;
+        const double qbaNs = Bench::nsPerCall([&]() { Bench::sink = Bench::sink + viaByteArray(rxBuffer, burst); });
+        std::snprintf(what, sizeof what, "QByteArray left/remove, %d MB burst", mb);
+        Bench::report("rx", what, burst.size() / (qbaNs / 1e9) / (1 << 20), "MB/s");
+        std::snprintf(what, sizeof what, "QByteArray left/remove, %d MB burst, per frame", mb);
+        Bench::report("rx", what, qbaNs / frames, "ns");
+    }
+}
@@ -0,0 +1,200 @@
+#include "bench.h"
+#include "egrambuffer.h"
+#include "egramdetector.h"
+#include "spscqueue.h"
+
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// The I/O-thread -> renderer queues under load. "Uncontended" runs the
+// producer and the consumer alternately on one thread; "contended" runs
+// them flat-out on two threads, so every index update crosses cores.
+// A mutex-guarded deque carries the same traffic for comparison.
+namespace {
+constexpr int BLOCK = 64;            // PacemakerLink::EGRAM_BLOCK
+constexpr int DRAIN_MAX = 1024;      // one renderer drain
+constexpr int CAPACITY = 4096;       // PacemakerLink's EGRAM_CAPACITY
+constexpr quint32 TOTAL = 1u << 22;  // samples per contended run
+
+struct Sample {
+    quint32 timeMs;
+    float   atrial;
+    float   ventricular;
+};
+
+// Same interface as the renderer sees, behind one lock.
+class LockedQueue {
+public:
+    int pushBlock(const quint32* t, const float* a, const float* v, int n)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int room = qMin(n, CAPACITY - static_cast<int>(m_items.size()));
+        for (int i = 0; i < room; ++i)
+            m_items.push_back({ t[i], a[i], v[i] });
+        return room;
+    }
+
+    int drain(quint32* t, float* a, float* v, int max)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int n = qMin(max, static_cast<int>(m_items.size()));
+        for (int i = 0; i < n; ++i) {
+            const Sample& s = m_items.front();
+            t[i] = s.timeMs;
+            a[i] = s.atrial;
+            v[i] = s.ventricular;
+            m_items.pop_front();
+        }
+        return n;
+    }
+
+private:
+    std::mutex         m_mutex;
+    std::deque<Sample> m_items;
+};
+
+template <typename Queue>
+double uncontendedNsPerSample(Queue& q)
+{
+    quint32 t[DRAIN_MAX];
+    float   a[DRAIN_MAX];
+    float   v[DRAIN_MAX];
+    for (int i = 0; i < BLOCK; ++i) {
+        t[i] = static_cast<quint32>(i);
+        a[i] = v[i] = 0.5f * i;
+    }
+
+    // Fill a renderer's worth of blocks, then drain them, like one tick.
+    constexpr int BLOCKS = DRAIN_MAX / BLOCK;
+    const double ns = Bench::nsPerCall([&]() {
+        for (int b = 0; b < BLOCKS; ++b)
+            q.pushBlock(t, a, v, BLOCK);
+        Bench::sink = Bench::sink + static_cast<quint64>(q.drain(t + BLOCK, a + BLOCK, v + BLOCK, DRAIN_MAX - BLOCK))
+                                  + static_cast<quint64>(q.drain(t + BLOCK, a + BLOCK, v + BLOCK, BLOCK));
+    });
+    return ns / DRAIN_MAX;
+}
+
+// Producer on its own thread, pushing in order and retrying what did not
+// fit; the consumer checks every timestamp. Returns samples per second,
+// or 0 if anything arrived out of order.
+template <typename Queue>
+double contendedSamplesPerSec(Queue& q)
+{
+    std::atomic<bool> start{false};
+
+    std::thread producer([&]() {
+        quint32 t[BLOCK];
+        float   a[BLOCK];
+        float   v[BLOCK];
+        while (!start.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        for (quint32 next = 0; next < TOTAL;) {
+            const int n = static_cast<int>(qMin<quint32>(BLOCK, TOTAL - next));
+            for (int i = 0; i < n; ++i) {
+                t[i] = next + static_cast<quint32>(i);
+                a[i] = v[i] = static_cast<float>(i);
+            }
+            int done = 0;
+            while (done < n) {
+                const int k = q.pushBlock(t + done, a + done, v + done, n - done);
+                if (k == 0)
+                    std::this_thread::yield();
+                done += k;
+            }
+            next += static_cast<quint32>(n);
+        }
+    });
+
+    static quint32 t[DRAIN_MAX];
+    static float   a[DRAIN_MAX];
+    static float   v[DRAIN_MAX];
+    bool inOrder = true;
+
+    QElapsedTimer timer;
+    timer.start();
+    start.store(true, std::memory_order_release);
+    for (quint32 expect = 0; expect < TOTAL;) {
+        const int n = q.drain(t, a, v, DRAIN_MAX);
+        if (n == 0)
+            std::this_thread::yield();
+        for (int i = 0; i < n; ++i)
+            inOrder = inOrder && t[i] == expect + static_cast<quint32>(i);
+        expect += static_cast<quint32>(n);
+    }
+    const qint64 ns = timer.nsecsElapsed();
+    producer.join();
+
+    return inOrder ? TOTAL / (ns / 1e9) : 0.0;
+}
+
+// Markers: one item at a time, which is how the detector queues them.
+double contendedMarkersPerSec()
+{
+    SpscQueue<EgramMarker> q(256);   // PacemakerLink's MARKER_CAPACITY
+    std::atomic<bool> start{false};
+
+    std::thread producer([&]() {
+        while (!start.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        EgramMarker m;
+        for (quint32 i = 0; i < TOTAL; ++i) {
+            m.timeMs = i;
+            while (!q.push(m))
+                std::this_thread::yield();
+        }
+    });
+
+    bool inOrder = true;
+    QElapsedTimer timer;
+    timer.start();
+    start.store(true, std::memory_order_release);
+    EgramMarker m;
+    for (quint32 expect = 0; expect < TOTAL;) {
+        if (q.pop(&m)) {
+            inOrder = inOrder && m.timeMs == expect;
+            ++expect;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    const qint64 ns = timer.nsecsElapsed();
+    producer.join();
+
+    return inOrder ? TOTAL / (ns / 1e9) : 0.0;
+}
+}
+
+void benchSpsc()
+{
+    {
+        EgramBuffer q(CAPACITY);
+        Bench::report("spsc", "EgramBuffer, uncontended", uncontendedNsPerSample(q), "ns/sample");
+    }
+    {
+        LockedQueue q;
+        Bench::report("spsc", "mutex + deque, uncontended", uncontendedNsPerSample(q), "ns/sample");
+    }
+
+    // On one core the two threads only take turns, which measures the
+    // scheduler rather than the queue.
+    if (std::thread::hardware_concurrency() < 2) {
+        std::printf("# spsc: contended runs need two cores, skipped\n");
+        return;
+    }
+    {
+        EgramBuffer q(CAPACITY);
+        Bench::report("spsc", "EgramBuffer, contended (2 threads)", contendedSamplesPerSec(q) / 1e6, "M samples/s");
+    }
+    {
+        LockedQueue q;
+        Bench::report("spsc", "mutex + deque, contended (2 threads)", contendedSamplesPerSec(q) / 1e6, "M samples/s");
+    }
+    Bench::report("spsc", "SpscQueue<EgramMarker>, contended (2 threads)", contendedMarkersPerSec() / 1e6, "M items/s");
+}
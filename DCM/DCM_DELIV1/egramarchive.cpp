@@ -0,0 +1,311 @@
+#include "egramarchive.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace EgramFile;
+
+namespace {
+// Entries of one pyramid level folded into one of the next.
+constexpr int LEVEL_FAN = 8;
+}
+
+// -------------------------------------------------------------
+// Open / close
+// -------------------------------------------------------------
+bool EgramArchive::open(const QString& path, QString* err)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (err) *err = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size < HEADER_SIZE) {
+        if (err) *err = "Not an egram recording.";
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        if (err) *err = m_file.errorString();
+        close();
+        return false;
+    }
+
+    if (!readHeader(m_data, &m_header)) {
+        if (err) *err = "Not an egram recording, or an unsupported version.";
+        close();
+        return false;
+    }
+
+    // No usable footer: the recorder never reached stop(). The chunks
+    // written before that are still complete.
+    if (!loadIndex() && !scanChunks()) {
+        if (err) *err = "Recording is damaged.";
+        close();
+        return false;
+    }
+
+    m_samples = 0;
+    for (const IndexEntry& e : std::as_const(m_index))
+        m_samples += e.summary.count;
+    buildLevels();
+    return true;
+}
+
+void EgramArchive::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_data = nullptr;
+    m_size = 0;
+    m_index.clear();
+    m_levels.clear();
+    m_samples = 0;
+    m_header = FileHeader{};
+    m_file.close();
+}
+
+int EgramArchive::sampleRate() const
+{
+    return m_header.sampleRateHz ? static_cast<int>(m_header.sampleRateHz) : 1000;
+}
+
+bool EgramArchive::loadIndex()
+{
+    if (m_size < HEADER_SIZE + TRAILER_SIZE)
+        return false;
+
+    quint64 offset;
+    quint32 entries;
+    if (!readTrailer(m_data + m_size - TRAILER_SIZE, &offset, &entries))
+        return false;
+
+    const quint64 indexEnd = offset + static_cast<quint64>(entries) * INDEX_ENTRY_SIZE;
+    if (offset < HEADER_SIZE || indexEnd != static_cast<quint64>(m_size - TRAILER_SIZE))
+        return false;
+
+    m_index.resize(static_cast<int>(entries));
+    for (quint32 i = 0; i < entries; ++i) {
+        IndexEntry& e = m_index[static_cast<int>(i)];
+        readIndexEntry(m_data + offset + i * INDEX_ENTRY_SIZE, &e);
+        if (e.offset + CHUNK_HEADER_SIZE > offset) {
+            m_index.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EgramArchive::scanChunks()
+{
+    m_index.clear();
+
+    qint64 pos = HEADER_SIZE;
+    while (pos + CHUNK_HEADER_SIZE <= m_size) {
+        ChunkHeader h;
+        if (!readChunkHeader(m_data + pos, &h))
+            break;
+        const qint64 next = pos + h.totalBytes();
+        if (next > m_size)
+            break;                             // torn final write
+
+        // Rebuild the index entry from the chunk's own block summaries.
+        Summary blocks[summaryCount(CHUNK_SAMPLES)];
+        readChunkSummaries(h, m_data + pos, blocks);
+
+        IndexEntry e;
+        e.offset = static_cast<quint64>(pos);
+        for (int b = 0; b < summaryCount(static_cast<int>(h.sampleCount)); ++b)
+            e.summary.merge(blocks[b]);
+        m_index.append(e);
+        pos = next;
+    }
+    return pos > HEADER_SIZE || m_size == HEADER_SIZE;
+}
+
+void EgramArchive::buildLevels()
+{
+    m_levels.clear();
+
+    QVector<Summary> level;
+    level.reserve(m_index.size());
+    for (const IndexEntry& e : std::as_const(m_index))
+        level.append(e.summary);
+    m_levels.append(level);
+
+    while (m_levels.last().size() > 1) {
+        const QVector<Summary>& below = m_levels.last();
+        QVector<Summary> next;
+        next.reserve((below.size() + LEVEL_FAN - 1) / LEVEL_FAN);
+        for (int i = 0; i < below.size(); i += LEVEL_FAN) {
+            Summary s;
+            for (int k = i; k < qMin(i + LEVEL_FAN, below.size()); ++k)
+                s.merge(below[k]);
+            next.append(s);
+        }
+        m_levels.append(next);
+    }
+}
+
+// -------------------------------------------------------------
+// Lookup / decode
+// -------------------------------------------------------------
+int EgramArchive::findChunk(quint32 timeMs) const
+{
+    const auto it = std::partition_point(m_index.cbegin(), m_index.cend(),
+                                         [timeMs](const IndexEntry& e) { return e.summary.lastTimeMs < timeMs; });
+    return static_cast<int>(it - m_index.cbegin());
+}
+
+bool EgramArchive::chunkHeaderAt(int i, ChunkHeader* h) const
+{
+    const quint64 offset = m_index[i].offset;
+    return offset + CHUNK_HEADER_SIZE <= static_cast<quint64>(m_size)
+        && readChunkHeader(m_data + offset, h)
+        && offset + h->totalBytes() <= static_cast<quint64>(m_size);
+}
+
+int EgramArchive::readChunk(int i, quint32* timeMs, float* atrial, float* ventricular,
+                           EgramMarker* markers, int* markerCount) const
+{
+    EgramMarker scratch[MAX_CHUNK_MARKERS];
+    ChunkHeader h;
+    if (i < 0 || i >= m_index.size() || !chunkHeaderAt(i, &h)
+        || !decodeChunk(h, m_data + m_index[i].offset, timeMs, atrial, ventricular,
+                        markers ? markers : scratch))
+        return -1;
+    if (markerCount)
+        *markerCount = static_cast<int>(h.markerCount);
+    return static_cast<int>(h.sampleCount);
+}
+
+bool EgramArchive::read(quint32 fromMs, quint32 toMs, Window* out, QString* err) const
+{
+    out->timeMs.clear();
+    out->atrial.clear();
+    out->ventricular.clear();
+    out->markers.clear();
+    if (!m_data || toMs < fromMs)
+        return true;
+
+    std::vector<quint32>     t(CHUNK_SAMPLES);
+    std::vector<float>       a(CHUNK_SAMPLES);
+    std::vector<float>       v(CHUNK_SAMPLES);
+    std::vector<EgramMarker> m(MAX_CHUNK_MARKERS);
+
+    // A marker is filed with whatever chunk was open when the writer
+    // popped it, which can be the neighbour of the one holding its sample;
+    // so one extra chunk is decoded on each side.
+    const int first = qMax(0, findChunk(fromMs) - 1);
+    int last = first;
+    while (last < m_index.size() && m_index[last].summary.firstTimeMs <= toMs)
+        ++last;
+    last = qMin(last + 1, m_index.size());
+
+    for (int i = first; i < last; ++i) {
+        ChunkHeader h;
+        if (!chunkHeaderAt(i, &h)
+            || !decodeChunk(h, m_data + m_index[i].offset, t.data(), a.data(), v.data(), m.data())) {
+            if (err) *err = QString("Chunk %1 is damaged.").arg(i);
+            return false;
+        }
+
+        // Chunks are contiguous in time, so only the first and last of the
+        // range need trimming.
+        const int n = static_cast<int>(h.sampleCount);
+        const int lo = static_cast<int>(std::lower_bound(t.begin(), t.begin() + n, fromMs) - t.begin());
+        const int hi = static_cast<int>(std::upper_bound(t.begin(), t.begin() + n, toMs) - t.begin());
+        for (int k = lo; k < hi; ++k) {
+            out->timeMs.append(t[k]);
+            out->atrial.append(a[k]);
+            out->ventricular.append(v[k]);
+        }
+
+        for (quint32 k = 0; k < h.markerCount; ++k)
+            if (m[k].timeMs >= fromMs && m[k].timeMs <= toMs)
+                out->markers.append(m[k]);
+    }
+
+    std::stable_sort(out->markers.begin(), out->markers.end(),
+                     [](const EgramMarker& x, const EgramMarker& y) { return x.timeMs < y.timeMs; });
+    return true;
+}
+
+bool EgramArchive::readSummaries(quint32 fromMs, quint32 toMs, int samplesPerBucket,
+                                 QVector<Summary>* out, QString* err) const
+{
+    out->clear();
+    if (!m_data || toMs < fromMs || m_index.isEmpty())
+        return true;
+
+    const auto overlaps = [fromMs, toMs](const Summary& s) {
+        return s.lastTimeMs >= fromMs && s.firstTimeMs <= toMs;
+    };
+
+    // Chunk granularity or coarser: straight from the in-memory pyramid.
+    if (samplesPerBucket >= CHUNK_SAMPLES) {
+        int level = 0;
+        qint64 span = CHUNK_SAMPLES;
+        while (level + 1 < m_levels.size() && span * LEVEL_FAN <= samplesPerBucket) {
+            span *= LEVEL_FAN;
+            ++level;
+        }
+
+        const QVector<Summary>& entries = m_levels[level];
+        auto it = std::partition_point(entries.cbegin(), entries.cend(),
+                                       [fromMs](const Summary& s) { return s.lastTimeMs < fromMs; });
+        for (; it != entries.cend() && it->firstTimeMs <= toMs; ++it)
+            out->append(*it);
+        return true;
+    }
+
+    // Finer: each overlapping chunk's stored block summaries, or, below
+    // SUMMARY_BLOCK, summaries of its decoded samples.
+    const bool fromBlocks = samplesPerBucket >= SUMMARY_BLOCK;
+    const int bucket = fromBlocks ? SUMMARY_BLOCK : qMax(1, samplesPerBucket);
+    std::vector<Summary> buckets(static_cast<size_t>(summaryCount(CHUNK_SAMPLES, bucket)));
+    std::vector<quint32> t;
+    std::vector<float>   a;
+    std::vector<float>   v;
+    std::vector<EgramMarker> m;
+    if (!fromBlocks) {
+        t.resize(CHUNK_SAMPLES);
+        a.resize(CHUNK_SAMPLES);
+        v.resize(CHUNK_SAMPLES);
+        m.resize(MAX_CHUNK_MARKERS);
+    }
+
+    for (int i = findChunk(fromMs); i < m_index.size() && m_index[i].summary.firstTimeMs <= toMs; ++i) {
+        ChunkHeader h;
+        if (!chunkHeaderAt(i, &h)) {
+            if (err) *err = QString("Chunk %1 is damaged.").arg(i);
+            return false;
+        }
+
+        const quint8* chunk = m_data + m_index[i].offset;
+        const int n = static_cast<int>(h.sampleCount);
+        int count;
+        if (fromBlocks) {
+            readChunkSummaries(h, chunk, buckets.data());
+            count = summaryCount(n);
+        } else {
+            if (!decodeChunk(h, chunk, t.data(), a.data(), v.data(), m.data())) {
+                if (err) *err = QString("Chunk %1 is damaged.").arg(i);
+                return false;
+            }
+            summarize(t.data(), a.data(), v.data(), n, bucket, buckets.data());
+            count = summaryCount(n, bucket);
+        }
+
+        for (int b = 0; b < count; ++b)
+            if (overlaps(buckets[b]))
+                out->append(buckets[b]);
+    }
+    return true;
+}
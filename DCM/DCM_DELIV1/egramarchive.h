@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "egramdetector.h"   // EgramMarker
+#include "egramfile.h"
+
+// Read-only view of an .egr recording (see egramfile.h).
+//
+// The file is memory-mapped, not read: open() parses only the header and
+// the footer index (or, for a recording that was cut short, walks the
+// chunk headers), so it costs the same for a minute as for a day. read()
+// binary-searches the index and decodes just the chunks that overlap the
+// requested window; the OS pages in only what those chunks touch.
+//
+// For zoomed-out views readSummaries() answers from a min/max/mean
+// pyramid instead: the block summaries stored in each chunk, the chunk
+// summaries in the index, and coarser levels folded from those at open.
+// Cost follows the number of buckets returned, not the time span.
+//
+// Timestamps are the device's, and ascend through the file.
+class EgramArchive {
+public:
+    // Samples and markers of one time window, oldest first.
+    struct Window {
+        QVector<quint32>     timeMs;
+        QVector<float>       atrial;
+        QVector<float>       ventricular;
+        QVector<EgramMarker> markers;
+    };
+
+    EgramArchive() = default;
+    ~EgramArchive() { close(); }
+
+    EgramArchive(const EgramArchive&) = delete;
+    EgramArchive& operator=(const EgramArchive&) = delete;
+
+    bool open(const QString& path, QString* err = nullptr);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    QString path() const { return m_file.fileName(); }
+
+    const EgramFile::FileHeader& header() const { return m_header; }
+    int     sampleRate() const;
+    quint32 firstTimeMs() const { return m_index.isEmpty() ? 0 : m_index.first().summary.firstTimeMs; }
+    quint32 lastTimeMs() const  { return m_index.isEmpty() ? 0 : m_index.last().summary.lastTimeMs; }
+    quint64 sampleCount() const { return m_samples; }
+
+    int chunkCount() const { return m_index.size(); }
+    const EgramFile::IndexEntry& chunk(int i) const { return m_index[i]; }
+
+    // First chunk whose samples end at or after timeMs; chunkCount() if none.
+    int findChunk(quint32 timeMs) const;
+
+    // Decode chunk i into arrays of CHUNK_SAMPLES, and optionally its
+    // markers into one of MAX_CHUNK_MARKERS. Returns the sample count, or
+    // -1 if the chunk is damaged.
+    int readChunk(int i, quint32* timeMs, float* atrial, float* ventricular,
+                  EgramMarker* markers = nullptr, int* markerCount = nullptr) const;
+
+    // Everything with fromMs <= time <= toMs. False (with err) if a chunk
+    // in range is damaged; out then holds what was decoded before it.
+    bool read(quint32 fromMs, quint32 toMs, Window* out, QString* err = nullptr) const;
+
+    // Summaries covering fromMs..toMs, oldest first, each spanning at most
+    // samplesPerBucket samples (but as close to it as the pyramid allows).
+    // Edge buckets may reach past the window.
+    bool readSummaries(quint32 fromMs, quint32 toMs, int samplesPerBucket,
+                       QVector<EgramFile::Summary>* out, QString* err = nullptr) const;
+
+private:
+    bool loadIndex();
+    bool scanChunks();
+    void buildLevels();
+    bool chunkHeaderAt(int i, EgramFile::ChunkHeader* h) const;
+
+    QFile                          m_file;
+    const uchar*                   m_data{nullptr};
+    qint64                         m_size{0};
+    EgramFile::FileHeader          m_header;
+    QVector<EgramFile::IndexEntry> m_index;
+
+    // m_levels[k] summarizes LEVEL_FAN^k chunks per entry; [0] mirrors the index.
+    QVector<QVector<EgramFile::Summary>> m_levels;
+    quint64                        m_samples{0};
+};
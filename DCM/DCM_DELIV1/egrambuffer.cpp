@@ -0,0 +1,137 @@
+#include "egrambuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Copy n elements into the ring starting at index pos, handling the wrap point.
+template <typename T>
+void copyIn(std::vector<T>& ring, quint32 pos, int n, const T* src)
+{
+    const int first = std::min(n, static_cast<int>(ring.size() - pos));
+    std::memcpy(ring.data() + pos, src, sizeof(T) * static_cast<size_t>(first));
+    if (first < n)
+        std::memcpy(ring.data(), src + first, sizeof(T) * static_cast<size_t>(n - first));
+}
+
+// Copy n elements starting at ring index pos, handling the wrap point.
+template <typename T>
+void copyOut(const std::vector<T>& ring, quint32 pos, int n, T* dst)
+{
+    if (!dst)
+        return;
+
+    const int first = std::min(n, static_cast<int>(ring.size() - pos));
+    std::memcpy(dst, ring.data() + pos, sizeof(T) * static_cast<size_t>(first));
+    if (first < n)
+        std::memcpy(dst + first, ring.data(), sizeof(T) * static_cast<size_t>(n - first));
+}
+}
+
+// -------------------------------------------------------------
+// Construction
+// -------------------------------------------------------------
+EgramBuffer::EgramBuffer(int capacity)
+{
+    quint32 cap = 1;
+    while (cap < static_cast<quint32>(qMax(capacity, 1)))
+        cap <<= 1;
+
+    m_time.resize(cap);
+    m_atrial.resize(cap);
+    m_ventricular.resize(cap);
+    m_mask = cap - 1;
+}
+
+// -------------------------------------------------------------
+// Producer side
+// -------------------------------------------------------------
+bool EgramBuffer::push(quint32 timeMs, float atrial, float ventricular)
+{
+    const quint32 tail = m_tail.load(std::memory_order_relaxed);
+
+    // Only re-read the consumer's index when the cached one says full.
+    if (tail - m_headCache == m_mask + 1) {
+        m_headCache = m_head.load(std::memory_order_acquire);
+        if (tail - m_headCache == m_mask + 1) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    const quint32 pos = tail & m_mask;
+    m_time[pos]        = timeMs;
+    m_atrial[pos]      = atrial;
+    m_ventricular[pos] = ventricular;
+
+    m_tail.store(tail + 1, std::memory_order_release);
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+int EgramBuffer::pushBlock(const quint32* timeMs, const float* atrial,
+                           const float* ventricular, int n)
+{
+    const quint32 tail = m_tail.load(std::memory_order_relaxed);
+
+    int room = static_cast<int>(m_mask + 1 - (tail - m_headCache));
+    if (room < n) {
+        m_headCache = m_head.load(std::memory_order_acquire);
+        room = static_cast<int>(m_mask + 1 - (tail - m_headCache));
+    }
+
+    const int accepted = std::min(n, room);
+    if (accepted < n)
+        m_overflows.fetch_add(static_cast<quint64>(n - accepted), std::memory_order_relaxed);
+    if (accepted <= 0)
+        return 0;
+
+    const quint32 pos = tail & m_mask;
+    copyIn(m_time,        pos, accepted, timeMs);
+    copyIn(m_atrial,      pos, accepted, atrial);
+    copyIn(m_ventricular, pos, accepted, ventricular);
+
+    m_tail.store(tail + static_cast<quint32>(accepted), std::memory_order_release);
+    m_pushed.fetch_add(static_cast<quint64>(accepted), std::memory_order_relaxed);
+    return accepted;
+}
+
+int EgramBuffer::writeAvailable() const
+{
+    m_headCache = m_head.load(std::memory_order_acquire);
+    return static_cast<int>(m_mask + 1 - (m_tail.load(std::memory_order_relaxed) - m_headCache));
+}
+
+// -------------------------------------------------------------
+// Consumer side
+// -------------------------------------------------------------
+int EgramBuffer::readAvailable() const
+{
+    m_tailCache = m_tail.load(std::memory_order_acquire);
+    return static_cast<int>(m_tailCache - m_head.load(std::memory_order_relaxed));
+}
+
+int EgramBuffer::drain(quint32* timeMs, float* atrial, float* ventricular, int max)
+{
+    const quint32 head = m_head.load(std::memory_order_relaxed);
+
+    int n = static_cast<int>(m_tailCache - head);
+    if (n < max)
+        n = readAvailable();
+    n = std::min(n, max);
+    if (n <= 0)
+        return 0;
+
+    const quint32 pos = head & m_mask;
+    copyOut(m_time,        pos, n, timeMs);
+    copyOut(m_atrial,      pos, n, atrial);
+    copyOut(m_ventricular, pos, n, ventricular);
+
+    m_head.store(head + static_cast<quint32>(n), std::memory_order_release);
+    return n;
+}
+
+void EgramBuffer::discard()
+{
+    m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+}
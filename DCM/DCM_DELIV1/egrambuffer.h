@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// Lock-free single-producer/single-consumer queue of decoded egram samples.
+//
+// One contiguous array per channel (structure of arrays), allocated once.
+// The producer (PacemakerLink's I/O thread) calls push(); the consumer
+// (the egram renderer, on the GUI thread) calls drain() once per paint.
+// Each index lives on its own cache line next to a cached copy of the
+// other side's index, so in steady state neither thread touches the
+// line the other one writes.
+//
+// When the consumer falls behind, new samples are dropped and counted;
+// the producer never blocks and never moves the consumer's index.
+class EgramBuffer {
+public:
+    // Capacity (in samples) is rounded up to the next power of two.
+    explicit EgramBuffer(int capacity);
+
+    EgramBuffer(const EgramBuffer&) = delete;
+    EgramBuffer& operator=(const EgramBuffer&) = delete;
+
+    int capacity() const { return static_cast<int>(m_mask + 1); }
+
+    // ---- Producer thread ----
+    // False if the queue was full; the sample is dropped and counted.
+    bool push(quint32 timeMs, float atrial, float ventricular);
+
+    // Push n samples at once; whatever does not fit is dropped and counted.
+    // Returns the number accepted.
+    int pushBlock(const quint32* timeMs, const float* atrial, const float* ventricular, int n);
+
+    // Free slots; a push of this many will not drop. For producers that
+    // would rather wait than drop (replay).
+    int writeAvailable() const;
+
+    // ---- Consumer thread ----
+    // Samples ready to drain.
+    int readAvailable() const;
+
+    // Copy up to max of the oldest samples into the caller's arrays and
+    // release them. Any destination may be null to skip that channel.
+    // Returns the number of samples drained.
+    int drain(quint32* timeMs, float* atrial, float* ventricular, int max);
+
+    // Release everything currently queued without copying it.
+    void discard();
+
+    // ---- Any thread ----
+    quint64 pushed() const    { return m_pushed.load(std::memory_order_relaxed); }
+    quint64 overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int CACHE_LINE = 64;
+
+    std::vector<quint32> m_time;
+    std::vector<float>   m_atrial;
+    std::vector<float>   m_ventricular;
+    quint32 m_mask{0};
+
+    // Free-running counters; size is tail - head even across wrap-around.
+    // Producer line: tail it owns, plus its last view of head.
+    alignas(CACHE_LINE) std::atomic<quint32> m_tail{0};
+    mutable quint32                          m_headCache{0};
+    std::atomic<quint64>                     m_pushed{0};
+    std::atomic<quint64>                     m_overflows{0};
+
+    // Consumer line: head it owns, plus its last view of tail.
+    alignas(CACHE_LINE) std::atomic<quint32> m_head{0};
+    mutable quint32                          m_tailCache{0};
+};
@@ -0,0 +1,122 @@
+#include "egramdetector.h"
+
+#include <cmath>
+
+// -------------------------------------------------------------
+// Configuration
+// -------------------------------------------------------------
+EgramDetector::Config EgramDetector::fromProfile(const Database::ModeProfile& p)
+{
+    Config c;
+    if (p.aSens && *p.aSens > 0.0)
+        c.aThresholdMv = static_cast<float>(*p.aSens);
+    if (p.vSens && *p.vSens > 0.0)
+        c.vThresholdMv = static_cast<float>(*p.vSens);
+    if (p.arp)
+        c.arpMs = *p.arp;
+    if (p.vrp)
+        c.vrpMs = *p.vrp;
+    return c;
+}
+
+void EgramDetector::configure(const Config& config)
+{
+    m_config = config;
+    reset();
+}
+
+void EgramDetector::reset()
+{
+    m_atrial = ChannelState{};
+    m_atrial.threshold = m_config.aThresholdMv;
+    m_atrial.refractoryMs = m_config.arpMs;
+
+    m_ventricular = ChannelState{};
+    m_ventricular.threshold = m_config.vThresholdMv;
+    m_ventricular.refractoryMs = m_config.vrpMs;
+
+    m_rr.fill(0);
+    m_rrCount = 0;
+    m_rrNext = 0;
+    m_rrSum = 0;
+    m_haveLastV = false;
+}
+
+// -------------------------------------------------------------
+// Detection
+// -------------------------------------------------------------
+int EgramDetector::process(const quint32* timeMs, const float* atrial, const float* ventricular,
+                           int n, EgramMarker* out, int maxOut)
+{
+    int written = 0;
+
+    for (int i = 0; i < n; ++i) {
+        const quint32 t = timeMs[i];
+        bool paced = false;
+
+        if (detect(m_atrial, t, atrial[i], &paced) && written < maxOut) {
+            EgramMarker& m = out[written++];
+            m.timeMs = t;
+            m.kind = paced ? EgramMarker::AtrialPace : EgramMarker::AtrialSense;
+            m.rateBpm = 0.0f;
+        }
+
+        if (detect(m_ventricular, t, ventricular[i], &paced)) {
+            const float rate = updateRate(t);
+            if (written < maxOut) {
+                EgramMarker& m = out[written++];
+                m.timeMs = t;
+                m.kind = paced ? EgramMarker::VentricularPace : EgramMarker::VentricularSense;
+                m.rateBpm = rate;
+            }
+        }
+    }
+
+    return written;
+}
+
+bool EgramDetector::detect(ChannelState& s, quint32 t, float x, bool* paced)
+{
+    const float step = s.havePrev ? std::fabs(x - s.prev) : 0.0f;
+    s.prev = x;
+    s.havePrev = true;
+
+    const float mag = std::fabs(x);
+    if (mag < 0.5f * s.threshold)
+        s.armed = true;
+
+    // Unsigned difference stays correct across timestamp wrap.
+    if (s.haveEvent && static_cast<qint64>(t - s.lastEventMs) < s.refractoryMs)
+        return false;
+
+    if (step >= m_config.paceSlewMv) {
+        *paced = true;
+    } else if (s.armed && mag >= s.threshold) {
+        *paced = false;
+    } else {
+        return false;
+    }
+
+    s.armed = false;
+    s.haveEvent = true;
+    s.lastEventMs = t;
+    return true;
+}
+
+float EgramDetector::updateRate(quint32 t)
+{
+    if (m_haveLastV) {
+        const quint32 rr = t - m_lastVMs;
+        m_rrSum -= m_rr[m_rrNext];
+        m_rr[m_rrNext] = rr;
+        m_rrSum += rr;
+        m_rrNext = (m_rrNext + 1) % RR_WINDOW;
+        m_rrCount = qMin(m_rrCount + 1, RR_WINDOW);
+    }
+    m_haveLastV = true;
+    m_lastVMs = t;
+
+    if (m_rrCount == 0 || m_rrSum == 0)
+        return 0.0f;
+    return static_cast<float>(60000.0 * m_rrCount / m_rrSum);
+}
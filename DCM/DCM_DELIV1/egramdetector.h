@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+
+#include "database.h"  // Database::ModeProfile
+
+// One detected cardiac event.
+struct EgramMarker {
+    enum Kind : quint8 { AtrialSense, AtrialPace, VentricularSense, VentricularPace };
+
+    quint32 timeMs{0};        // timestamp of the sample that triggered it
+    Kind    kind{AtrialSense};
+    float   rateBpm{0.0f};    // ventricular events: smoothed rate, 0 until known
+};
+
+// Streaming sense/pace detector for the two egram channels.
+//
+// Per channel: a pacing spike is a sample-to-sample step of at least
+// paceSlewMv; a sensed event is |x| reaching the sensitivity threshold
+// after the signal has fallen back below half of it. Either starts that
+// channel's refractory window, during which nothing more is detected.
+// Ventricular events also update a heart rate averaged over the last
+// RR_WINDOW intervals.
+//
+// O(1) per sample with no allocation; PacemakerLink runs it on each
+// filtered block on its I/O thread.
+class EgramDetector {
+public:
+    // Egram samples arrive in mV (packed frames carry ±32.767 mV), so the
+    // thresholds are a few mV and a pacing spike steps tens of mV within
+    // one sample.
+    struct Config {
+        float aThresholdMv{0.75f};
+        float vThresholdMv{2.5f};
+        int   arpMs{250};
+        int   vrpMs{320};
+        float paceSlewMv{10.0f};
+    };
+
+    // Thresholds from aSens/vSens and refractory windows from arp/vrp;
+    // unset fields keep the defaults. The sensitivity fields are labelled
+    // V in the profile, but their 0-5 range is the clinical sensitivity in
+    // mV, which is the egram's scale, so they are used as-is.
+    static Config fromProfile(const Database::ModeProfile& p);
+
+    void configure(const Config& config);
+    void reset();
+
+    // Scan n samples and write at most maxOut markers to out.
+    // Returns the number written; never more than 2 * n.
+    int process(const quint32* timeMs, const float* atrial, const float* ventricular,
+                int n, EgramMarker* out, int maxOut);
+
+private:
+    static constexpr int RR_WINDOW = 8;
+
+    struct ChannelState {
+        float   threshold{0.0f};
+        qint64  refractoryMs{0};
+        float   prev{0.0f};
+        bool    havePrev{false};
+        bool    armed{true};
+        bool    haveEvent{false};
+        quint32 lastEventMs{0};
+    };
+
+    // Returns true and sets *paced if an event fires on this sample.
+    bool detect(ChannelState& s, quint32 t, float x, bool* paced);
+    float updateRate(quint32 t);
+
+    Config m_config;
+    ChannelState m_atrial;
+    ChannelState m_ventricular;
+
+    // Last RR_WINDOW ventricular intervals and their running sum.
+    std::array<quint32, RR_WINDOW> m_rr{};
+    int     m_rrCount{0};
+    int     m_rrNext{0};
+    quint64 m_rrSum{0};
+    bool    m_haveLastV{false};
+    quint32 m_lastVMs{0};
+};
@@ -0,0 +1,395 @@
+#include "egramdsp.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EGRAMDSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+namespace EgramDsp {
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+
+// -------------------------------------------------------------
+// FIR kernels: y[i] = sum_k taps[k] * x[i + k], for i in [0, n)
+// -------------------------------------------------------------
+using FirKernel = void (*)(const float* x, const float* taps, int ntaps, float* y, int n);
+
+void firScalar(const float* x, const float* taps, int ntaps, float* y, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        float acc = 0.0f;
+        for (int k = 0; k < ntaps; ++k)
+            acc += taps[k] * x[i + k];
+        y[i] = acc;
+    }
+}
+
+#ifdef EGRAMDSP_X86
+// Several outputs per pass: each tap is broadcast once and multiplied into
+// a vector of consecutive outputs, so the loads are plain unaligned runs.
+void firSse(const float* x, const float* taps, int ntaps, float* y, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < ntaps; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(taps[k]), _mm_loadu_ps(x + i + k)));
+        _mm_storeu_ps(y + i, acc);
+    }
+    firScalar(x + i, taps, ntaps, y + i, n - i);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2,fma")))
+#endif
+void firAvx2(const float* x, const float* taps, int ntaps, float* y, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < ntaps; ++k)
+            acc = _mm256_fmadd_ps(_mm256_set1_ps(taps[k]), _mm256_loadu_ps(x + i + k), acc);
+        _mm256_storeu_ps(y + i, acc);
+    }
+    firSse(x + i, taps, ntaps, y + i, n - i);
+}
+
+bool cpuHasAvx2Fma()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 1);
+    const bool fma     = (r[2] & (1 << 12)) != 0;
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6)   // OS saves YMM state
+        return false;
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+struct KernelChoice {
+    FirKernel   fn;
+    const char* name;
+};
+
+KernelChoice pickFirKernel()
+{
+#ifdef EGRAMDSP_X86
+    if (cpuHasAvx2Fma())
+        return { firAvx2, "avx2" };
+    return { firSse, "sse" };
+#else
+    return { firScalar, "scalar" };
+#endif
+}
+
+const KernelChoice FIR_KERNEL = pickFirKernel();
+
+// -------------------------------------------------------------
+// FFT butterflies for one stage of half-size h >= 1:
+//   a = re/im[s + k], b = re/im[s + k + h], t = b * w[k]; a, b = a + t, a - t
+// -------------------------------------------------------------
+void butterfliesScalar(float* re, float* im, int n, int h, const float* wr, const float* wi)
+{
+    for (int s = 0; s < n; s += 2 * h) {
+        for (int k = 0; k < h; ++k) {
+            const int a = s + k, b = a + h;
+            const float tr = re[b] * wr[k] - im[b] * wi[k];
+            const float ti = re[b] * wi[k] + im[b] * wr[k];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+#ifdef EGRAMDSP_X86
+void butterfliesSse(float* re, float* im, int n, int h, const float* wr, const float* wi)
+{
+    if (h < 4) {
+        butterfliesScalar(re, im, n, h, wr, wi);
+        return;
+    }
+    for (int s = 0; s < n; s += 2 * h) {
+        for (int k = 0; k < h; k += 4) {
+            float* ar = re + s + k;
+            float* ai = im + s + k;
+            const __m128 wR = _mm_loadu_ps(wr + k);
+            const __m128 wI = _mm_loadu_ps(wi + k);
+            const __m128 bR = _mm_loadu_ps(ar + h);
+            const __m128 bI = _mm_loadu_ps(ai + h);
+            const __m128 tR = _mm_sub_ps(_mm_mul_ps(bR, wR), _mm_mul_ps(bI, wI));
+            const __m128 tI = _mm_add_ps(_mm_mul_ps(bR, wI), _mm_mul_ps(bI, wR));
+            const __m128 aR = _mm_loadu_ps(ar);
+            const __m128 aI = _mm_loadu_ps(ai);
+            _mm_storeu_ps(ar + h, _mm_sub_ps(aR, tR));
+            _mm_storeu_ps(ai + h, _mm_sub_ps(aI, tI));
+            _mm_storeu_ps(ar, _mm_add_ps(aR, tR));
+            _mm_storeu_ps(ai, _mm_add_ps(aI, tI));
+        }
+    }
+}
+
+const auto BUTTERFLIES = butterfliesSse;
+const char* const FFT_KERNEL_NAME = "sse";
+#else
+const auto BUTTERFLIES = butterfliesScalar;
+const char* const FFT_KERNEL_NAME = "scalar";
+#endif
+
+Biquad::Coeffs normalize(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+}
+}
+
+// -------------------------------------------------------------
+// Biquad
+// -------------------------------------------------------------
+Biquad::Coeffs Biquad::highPass(double cutoffHz, double sampleRateHz, double q)
+{
+    const double w0 = 2.0 * PI * cutoffHz / sampleRateHz;
+    const double c = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    return normalize((1.0 + c) / 2.0, -(1.0 + c), (1.0 + c) / 2.0,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+Biquad::Coeffs Biquad::lowPass(double cutoffHz, double sampleRateHz, double q)
+{
+    const double w0 = 2.0 * PI * cutoffHz / sampleRateHz;
+    const double c = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    return normalize((1.0 - c) / 2.0, 1.0 - c, (1.0 - c) / 2.0,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+Biquad::Coeffs Biquad::notch(double centerHz, double sampleRateHz, double q)
+{
+    const double w0 = 2.0 * PI * centerHz / sampleRateHz;
+    const double c = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * q);
+    return normalize(1.0, -2.0 * c, 1.0,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+void Biquad::process(float* atrial, float* ventricular, int n)
+{
+    // State in double: the baseline high-pass has poles very close to 1.
+    const Coeffs c = m_c;
+    double a1 = m_z[0][0], a2 = m_z[0][1];
+    double v1 = m_z[1][0], v2 = m_z[1][1];
+
+    for (int i = 0; i < n; ++i) {
+        const double xa = atrial[i];
+        const double xv = ventricular[i];
+        const double ya = c.b0 * xa + a1;
+        const double yv = c.b0 * xv + v1;
+        a1 = c.b1 * xa - c.a1 * ya + a2;
+        v1 = c.b1 * xv - c.a1 * yv + v2;
+        a2 = c.b2 * xa - c.a2 * ya;
+        v2 = c.b2 * xv - c.a2 * yv;
+        atrial[i]      = static_cast<float>(ya);
+        ventricular[i] = static_cast<float>(yv);
+    }
+
+    m_z[0][0] = a1; m_z[0][1] = a2;
+    m_z[1][0] = v1; m_z[1][1] = v2;
+}
+
+void Biquad::reset()
+{
+    std::memset(m_z, 0, sizeof(m_z));
+}
+
+// -------------------------------------------------------------
+// FIR
+// -------------------------------------------------------------
+Fir::Fir(std::vector<float> taps)
+    : m_taps(taps.rbegin(), taps.rend())
+{
+    reset();
+}
+
+std::vector<float> Fir::lowPassTaps(double cutoffHz, double sampleRateHz, int taps)
+{
+    std::vector<float> h(static_cast<size_t>(qMax(1, taps)));
+    const double fc = cutoffHz / sampleRateHz;
+    const double mid = (h.size() - 1) / 2.0;
+
+    double sum = 0.0;
+    for (size_t k = 0; k < h.size(); ++k) {
+        const double t = k - mid;
+        const double sinc = t == 0.0 ? 2.0 * fc : std::sin(2.0 * PI * fc * t) / (PI * t);
+        const double window = h.size() > 1 ? 0.54 - 0.46 * std::cos(2.0 * PI * k / (h.size() - 1)) : 1.0;
+        h[k] = static_cast<float>(sinc * window);
+        sum += h[k];
+    }
+    for (float& v : h)
+        v = static_cast<float>(v / sum);
+    return h;
+}
+
+void Fir::process(float* atrial, float* ventricular, int n)
+{
+    run(m_hist[0], atrial, n);
+    run(m_hist[1], ventricular, n);
+}
+
+void Fir::run(std::vector<float>& hist, float* x, int n)
+{
+    const int keep = static_cast<int>(m_taps.size()) - 1;
+
+    // Grows once to the largest block seen, then stays put.
+    if (static_cast<int>(hist.size()) < keep + n)
+        hist.resize(static_cast<size_t>(keep + n));
+
+    std::memcpy(hist.data() + keep, x, sizeof(float) * static_cast<size_t>(n));
+    FIR_KERNEL.fn(hist.data(), m_taps.data(), static_cast<int>(m_taps.size()), x, n);
+    std::memmove(hist.data(), hist.data() + n, sizeof(float) * static_cast<size_t>(keep));
+}
+
+void Fir::reset()
+{
+    for (std::vector<float>& h : m_hist)
+        h.assign(m_taps.size() - 1, 0.0f);
+}
+
+// -------------------------------------------------------------
+// FFT
+// -------------------------------------------------------------
+Fft::Fft(int size)
+    : m_n(4)
+{
+    while (m_n < size)
+        m_n <<= 1;
+
+    int bits = 0;
+    while ((1 << bits) < m_n)
+        ++bits;
+    for (int i = 0; i < m_n; ++i) {
+        int j = 0;
+        for (int b = 0; b < bits; ++b)
+            j |= ((i >> b) & 1) << (bits - 1 - b);
+        if (i < j) {
+            m_swaps.push_back(i);
+            m_swaps.push_back(j);
+        }
+    }
+
+    m_twRe.resize(static_cast<size_t>(m_n - 1));
+    m_twIm.resize(static_cast<size_t>(m_n - 1));
+    for (int h = 1; h < m_n; h *= 2) {
+        for (int k = 0; k < h; ++k) {
+            const double angle = -PI * k / h;
+            m_twRe[static_cast<size_t>(h - 1 + k)] = static_cast<float>(std::cos(angle));
+            m_twIm[static_cast<size_t>(h - 1 + k)] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    m_window.resize(static_cast<size_t>(m_n));
+    double sum = 0.0;
+    for (int i = 0; i < m_n; ++i) {
+        m_window[static_cast<size_t>(i)] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * i / m_n));
+        sum += m_window[static_cast<size_t>(i)];
+    }
+    m_scale = static_cast<float>(1.0 / (sum * sum));
+
+    m_re.resize(static_cast<size_t>(m_n));
+    m_im.resize(static_cast<size_t>(m_n));
+}
+
+void Fft::transform(float* re, float* im) const
+{
+    for (size_t p = 0; p < m_swaps.size(); p += 2) {
+        const int i = m_swaps[p], j = m_swaps[p + 1];
+        std::swap(re[i], re[j]);
+        std::swap(im[i], im[j]);
+    }
+    for (int h = 1; h < m_n; h *= 2)
+        BUTTERFLIES(re, im, m_n, h, m_twRe.data() + h - 1, m_twIm.data() + h - 1);
+}
+
+void Fft::powerSpectra(const float* a, const float* b, float* powerA, float* powerB)
+{
+    for (int i = 0; i < m_n; ++i) {
+        m_re[static_cast<size_t>(i)] = a[i] * m_window[static_cast<size_t>(i)];
+        m_im[static_cast<size_t>(i)] = b[i] * m_window[static_cast<size_t>(i)];
+    }
+    transform(m_re.data(), m_im.data());
+
+    // With Z = FFT(a + ib) and Y[k] = conj(Z[n - k]):
+    // A[k] = (Z[k] + Y[k]) / 2 and B[k] = (Z[k] - Y[k]) / 2i.
+    const int half = m_n / 2;
+    for (int k = 0; k <= half; ++k) {
+        const int m = (m_n - k) & (m_n - 1);
+        const float zr = m_re[static_cast<size_t>(k)], zi = m_im[static_cast<size_t>(k)];
+        const float yr = m_re[static_cast<size_t>(m)], yi = -m_im[static_cast<size_t>(m)];
+        const float sr = zr + yr, si = zi + yi;
+        const float dr = zr - yr, di = zi - yi;
+        // Interior bins carry the energy of their negative-frequency twin.
+        const float scale = (k == 0 || k == half ? 0.25f : 0.5f) * m_scale;
+        powerA[k] = (sr * sr + si * si) * scale;
+        powerB[k] = (dr * dr + di * di) * scale;
+    }
+}
+
+// -------------------------------------------------------------
+// Chain / presets
+// -------------------------------------------------------------
+void Chain::process(float* atrial, float* ventricular, int n)
+{
+    for (const std::unique_ptr<Stage>& s : m_stages)
+        s->process(atrial, ventricular, n);
+}
+
+void Chain::reset()
+{
+    for (const std::unique_ptr<Stage>& s : m_stages)
+        s->reset();
+}
+
+Chain buildChain(quint32 presets, double fs)
+{
+    const double nyquist = fs / 2.0;
+    Chain chain;
+
+    if (presets & BaselineRemoval)
+        chain.append(std::make_unique<Biquad>(Biquad::highPass(0.5, fs)));
+
+    if (presets & BandPass) {
+        chain.append(std::make_unique<Biquad>(Biquad::highPass(2.0, fs)));
+        if (100.0 < nyquist)
+            chain.append(std::make_unique<Fir>(Fir::lowPassTaps(100.0, fs, 63)));
+    }
+
+    if ((presets & Notch60) && 60.0 < nyquist)
+        chain.append(std::make_unique<Biquad>(Biquad::notch(60.0, fs, 30.0)));
+
+    return chain;
+}
+
+const char* firKernelName()
+{
+    return FIR_KERNEL.name;
+}
+
+const char* fftKernelName()
+{
+    return FFT_KERNEL_NAME;
+}
+
+} // namespace EgramDsp
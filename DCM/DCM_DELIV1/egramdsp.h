@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <memory>
+#include <vector>
+
+// Streaming filters for the two egram channels.
+//
+// A Stage filters one block of atrial and ventricular samples in place and
+// carries its state across blocks, so a stream can be fed in any block
+// size. Stages are chained; PacemakerLink runs the chain on its I/O thread
+// between the frame decoder and the sample queue.
+namespace EgramDsp {
+
+class Stage {
+public:
+    virtual ~Stage() = default;
+    virtual void process(float* atrial, float* ventricular, int n) = 0;
+    virtual void reset() = 0;
+};
+
+// Second-order IIR section, transposed direct form II.
+// The recursion is serial in time, so the two channels are run in the
+// same loop as independent dependency chains rather than vectorized.
+class Biquad : public Stage {
+public:
+    struct Coeffs {
+        double b0, b1, b2, a1, a2;   // a0 normalized to 1
+    };
+
+    // RBJ cookbook designs.
+    static Coeffs highPass(double cutoffHz, double sampleRateHz, double q = 0.7071);
+    static Coeffs lowPass(double cutoffHz, double sampleRateHz, double q = 0.7071);
+    static Coeffs notch(double centerHz, double sampleRateHz, double q);
+
+    explicit Biquad(const Coeffs& c) : m_c(c) {}
+
+    void process(float* atrial, float* ventricular, int n) override;
+    void reset() override;
+
+private:
+    Coeffs m_c;
+    double m_z[2][2]{};              // [channel][state]
+};
+
+// Direct-form FIR. The inner product runs on AVX2/FMA or SSE when the CPU
+// has them (chosen once at startup), otherwise on a scalar loop.
+class Fir : public Stage {
+public:
+    explicit Fir(std::vector<float> taps);
+
+    // Hamming-windowed sinc, unity DC gain. taps should be odd.
+    static std::vector<float> lowPassTaps(double cutoffHz, double sampleRateHz, int taps);
+
+    void process(float* atrial, float* ventricular, int n) override;
+    void reset() override;
+
+private:
+    void run(std::vector<float>& hist, float* x, int n);
+
+    std::vector<float> m_taps;       // reversed, so output i is dot(taps, hist + i)
+    std::vector<float> m_hist[2];    // last taps-1 inputs followed by the current block
+};
+
+class Chain {
+public:
+    void append(std::unique_ptr<Stage> stage) { m_stages.push_back(std::move(stage)); }
+    void process(float* atrial, float* ventricular, int n);
+    void reset();
+    bool isEmpty() const { return m_stages.empty(); }
+
+private:
+    std::vector<std::unique_ptr<Stage>> m_stages;
+};
+
+// In-place radix-2 FFT of one fixed power-of-two size on split real and
+// imaginary arrays. The bit-reversal swaps, per-stage twiddle tables, Hann
+// window and scratch are all built in the constructor, so transforms
+// allocate nothing. From the third stage on, butterflies run four at a
+// time on SSE (contiguous twiddles), otherwise on a scalar loop.
+class Fft {
+public:
+    explicit Fft(int size);          // rounded up to a power of two, at least 4
+
+    int size() const { return m_n; }
+    int bins() const { return m_n / 2 + 1; }
+
+    // Forward transform, in place.
+    void transform(float* re, float* im) const;
+
+    // One-sided power spectra (bins() values each) of two real blocks of
+    // size() samples, Hann-windowed and normalized to the window. Both go
+    // through a single complex transform, one as the real and one as the
+    // imaginary part.
+    void powerSpectra(const float* a, const float* b, float* powerA, float* powerB);
+
+private:
+    int m_n;
+    std::vector<int>   m_swaps;      // bit-reversal pairs, i < j
+    std::vector<float> m_twRe;       // stage with half-size h at offset h - 1
+    std::vector<float> m_twIm;
+    std::vector<float> m_window;
+    float              m_scale;      // 1 / (sum of window)^2
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+};
+
+// Filters selectable from the Egram tab, combined as bit flags.
+enum Preset : quint32 {
+    BaselineRemoval = 0x1,   // 0.5 Hz high-pass
+    BandPass        = 0x2,   // 2 Hz high-pass + 100 Hz FIR low-pass
+    Notch60         = 0x4,   // 60 Hz mains notch
+};
+
+// Chain for the given Preset bits at the given sample rate; stages that
+// do not fit under Nyquist are skipped.
+Chain buildChain(quint32 presets, double sampleRateHz);
+
+// FIR kernel picked for this CPU: "avx2", "sse" or "scalar".
+const char* firKernelName();
+
+// FFT butterfly kernel compiled in: "sse" or "scalar".
+const char* fftKernelName();
+
+} // namespace EgramDsp
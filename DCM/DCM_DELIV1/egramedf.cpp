@@ -0,0 +1,497 @@
+#include "egramedf.h"
+#include "egramarchive.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace EgramEdf {
+
+namespace {
+constexpr int FIELD_RECORDS = 236;    // header offset of "number of data records"
+
+// 1 µV per digital unit, as in .egr.
+constexpr double MV_PER_UNIT = 0.001;
+constexpr int    DIGITAL_MAX = 32767;
+
+void put(QByteArray& out, const QByteArray& text, int width)
+{
+    out += text.left(width).leftJustified(width, ' ');
+}
+
+QByteArray field(const QByteArray& header, int offset, int width)
+{
+    return header.mid(offset, width).trimmed();
+}
+
+const char* markerLabel(EgramMarker::Kind k)
+{
+    switch (k) {
+    case EgramMarker::AtrialSense:      return "AS";
+    case EgramMarker::AtrialPace:       return "AP";
+    case EgramMarker::VentricularSense: return "VS";
+    case EgramMarker::VentricularPace:  return "VP";
+    }
+    return "";
+}
+
+bool markerKind(const QByteArray& text, EgramMarker::Kind* k)
+{
+    const QByteArray t = text.trimmed().toUpper();
+    if (t == "AS")      *k = EgramMarker::AtrialSense;
+    else if (t == "AP") *k = EgramMarker::AtrialPace;
+    else if (t == "VS") *k = EgramMarker::VentricularSense;
+    else if (t == "VP") *k = EgramMarker::VentricularPace;
+    else                return false;
+    return true;
+}
+}
+
+// -------------------------------------------------------------
+// Writer
+// -------------------------------------------------------------
+Writer::~Writer()
+{
+    if (isOpen())
+        finish();
+}
+
+bool Writer::open(const QString& path, int sampleRateHz, qint64 startEpochMs, QString* err)
+{
+    if (isOpen())
+        finish();
+
+    if (sampleRateHz <= 0) {
+        if (err) *err = "Unknown sample rate.";
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (err) *err = m_file.errorString();
+        return false;
+    }
+
+    m_error.clear();
+    m_failed = false;
+    m_spr = sampleRateHz;
+    m_filled = 0;
+    m_record.assign(static_cast<size_t>(2 * m_spr + ANNOT_BYTES / 2), 0);
+    m_pending.clear();
+    m_pending.reserve(MAX_PENDING);
+    m_haveFirst = false;
+    m_records = 0;
+    m_written = 0;
+    m_markersWritten = 0;
+    m_markersDropped = 0;
+    m_bytes = 0;
+
+    const QDateTime start = QDateTime::fromMSecsSinceEpoch(startEpochMs);
+    const int signalCount = 3;
+    const QByteArray spr = QByteArray::number(m_spr);
+
+    QByteArray h;
+    h.reserve(256 * (signalCount + 1));
+    put(h, "0", 8);
+    put(h, "X X X X", 80);
+    put(h, "Startdate " + start.date().toString("dd-MMM-yyyy").toUpper().toLatin1() + " X X DCM", 80);
+    put(h, start.toString("dd.MM.yy").toLatin1(), 8);
+    put(h, start.toString("hh.mm.ss").toLatin1(), 8);
+    put(h, QByteArray::number(256 * (signalCount + 1)), 8);
+    put(h, "EDF+C", 44);
+    put(h, "-1", 8);
+    put(h, "1", 8);
+    put(h, QByteArray::number(signalCount), 4);
+
+    put(h, "EGM Atrial", 16);
+    put(h, "EGM Ventricular", 16);
+    put(h, "EDF Annotations", 16);
+    for (int i = 0; i < signalCount; ++i) put(h, i < 2 ? "Pacemaker lead" : "", 80);
+    for (int i = 0; i < signalCount; ++i) put(h, i < 2 ? "mV" : "", 8);
+    for (int i = 0; i < signalCount; ++i) put(h, i < 2 ? "-32.767" : "-1", 8);
+    for (int i = 0; i < signalCount; ++i) put(h, i < 2 ? "32.767" : "1", 8);
+    for (int i = 0; i < signalCount; ++i) put(h, i < 2 ? "-32767" : "-32768", 8);
+    for (int i = 0; i < signalCount; ++i) put(h, "32767", 8);
+    for (int i = 0; i < signalCount; ++i) put(h, "", 80);
+    put(h, spr, 8);
+    put(h, spr, 8);
+    put(h, QByteArray::number(ANNOT_BYTES / 2), 8);
+    for (int i = 0; i < signalCount; ++i) put(h, "", 32);
+
+    if (!writeBytes(h.constData(), h.size())) {
+        if (err) *err = m_error;
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool Writer::append(const quint32* timeMs, const float* atrial, const float* ventricular, int n)
+{
+    if (n > 0 && !m_haveFirst) {
+        m_firstTimeMs = timeMs[0];
+        m_haveFirst = true;
+    }
+
+    qint16* a = m_record.data();
+    qint16* v = m_record.data() + m_spr;
+    for (int i = 0; i < n && !m_failed; ++i) {
+        a[m_filled] = qToLittleEndian(static_cast<qint16>(
+            qBound(-DIGITAL_MAX, qRound(atrial[i] / MV_PER_UNIT), DIGITAL_MAX)));
+        v[m_filled] = qToLittleEndian(static_cast<qint16>(
+            qBound(-DIGITAL_MAX, qRound(ventricular[i] / MV_PER_UNIT), DIGITAL_MAX)));
+        ++m_written;
+        if (++m_filled == m_spr)
+            writeRecord();
+    }
+    return !m_failed;
+}
+
+bool Writer::appendMarker(const EgramMarker& marker)
+{
+    if (static_cast<int>(m_pending.size()) >= MAX_PENDING) {
+        ++m_markersDropped;
+        return false;
+    }
+    m_pending.push_back(marker);
+    return true;
+}
+
+bool Writer::finish(QString* err)
+{
+    if (!isOpen())
+        return !m_failed;
+
+    if (m_filled > 0 && !m_failed) {
+        std::fill(m_record.begin() + m_filled, m_record.begin() + m_spr, 0);
+        std::fill(m_record.begin() + m_spr + m_filled, m_record.begin() + 2 * m_spr, 0);
+        writeRecord();
+    }
+    m_markersDropped += m_pending.size();
+    m_pending.clear();
+
+    if (!m_failed) {
+        const QByteArray count = QByteArray::number(static_cast<qint64>(m_records)).leftJustified(8, ' ');
+        if (!m_file.seek(FIELD_RECORDS) || m_file.write(count) != count.size()) {
+            m_failed = true;
+            m_error = m_file.errorString();
+        }
+    }
+
+    m_file.close();
+    if (m_failed && err)
+        *err = m_error;
+    return !m_failed;
+}
+
+bool Writer::writeRecord()
+{
+    char* annot = reinterpret_cast<char*>(m_record.data() + 2 * m_spr);
+    std::memset(annot, 0, ANNOT_BYTES);
+
+    // Time-keeping TAL first, then the markers due by the end of this
+    // record, as many as fit; the rest wait for the next one (an onset
+    // need not fall inside its record).
+    int len = std::snprintf(annot, ANNOT_BYTES, "+%llu\x14\x14",
+                            static_cast<unsigned long long>(m_records)) + 1;
+    const qint64 endMs = static_cast<qint64>(m_records + 1) * 1000;
+    size_t done = 0;
+    for (; done < m_pending.size(); ++done) {
+        const EgramMarker& m = m_pending[done];
+        const qint64 ms = static_cast<qint32>(m.timeMs - m_firstTimeMs);
+        if (ms >= endMs)
+            break;
+        const qint64 absMs = ms < 0 ? -ms : ms;
+        char tal[48];
+        const int n = std::snprintf(tal, sizeof(tal), "%c%lld.%03lld\x14%s\x14", ms < 0 ? '-' : '+',
+                                    absMs / 1000, absMs % 1000, markerLabel(m.kind)) + 1;
+        if (len + n > ANNOT_BYTES)
+            break;
+        std::memcpy(annot + len, tal, static_cast<size_t>(n));
+        len += n;
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(done));
+    m_markersWritten += done;
+
+    m_filled = 0;
+    if (!writeBytes(reinterpret_cast<const char*>(m_record.data()),
+                    static_cast<qint64>(m_record.size() * sizeof(qint16))))
+        return false;
+    ++m_records;
+    return true;
+}
+
+bool Writer::writeBytes(const char* data, qint64 len)
+{
+    if (m_file.write(data, len) != len) {
+        m_failed = true;
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_bytes += static_cast<quint64>(len);
+    return true;
+}
+
+// -------------------------------------------------------------
+// Reader
+// -------------------------------------------------------------
+bool Reader::open(const QString& path, QString* err)
+{
+    close();
+    m_signals.clear();
+    m_atrial = m_ventricular = m_annotations = -1;
+    m_nextRecord = 0;
+
+    auto fail = [&](const QString& why) {
+        if (err) *err = why;
+        close();
+        return false;
+    };
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+
+    const QByteArray general = m_file.read(256);
+    if (general.size() != 256 || field(general, 0, 8) != "0")
+        return fail("Not an EDF file.");
+    if (field(general, 192, 44).startsWith("EDF+D"))
+        return fail("Discontinuous (EDF+D) recordings are not supported.");
+
+    bool ok = false;
+    const int headerBytes = field(general, 184, 8).toInt(&ok);
+    const int signalCount = ok ? field(general, 252, 4).toInt(&ok) : 0;
+    const double duration = ok ? field(general, 244, 8).toDouble(&ok) : 0.0;
+    m_recordCount = ok ? field(general, 236, 8).toLongLong(&ok) : 0;
+    if (!ok || signalCount <= 0 || headerBytes != 256 * (signalCount + 1) || duration <= 0.0)
+        return fail("EDF header is damaged.");
+
+    const QByteArray sig = m_file.read(256 * signalCount);
+    if (sig.size() != 256 * signalCount)
+        return fail("EDF header is damaged.");
+
+    // Per-signal fields are stored field by field across all signals.
+    auto at = [&](int fieldOffset, int width, int i) {
+        return field(sig, fieldOffset * signalCount + i * width, width);
+    };
+    int offset = 0;
+    for (int i = 0; i < signalCount; ++i) {
+        Signal s;
+        s.label = QString::fromLatin1(at(0, 16, i));
+        const QByteArray unit = at(96, 8, i).toLower();
+        const double physMin = at(104, 8, i).toDouble();
+        const double physMax = at(112, 8, i).toDouble();
+        const double digMin  = at(120, 8, i).toDouble();
+        const double digMax  = at(128, 8, i).toDouble();
+        s.samples = at(216, 8, i).toInt();
+        s.offset = offset;
+        offset += s.samples;
+        if (s.samples <= 0 || digMax <= digMin)
+            return fail("EDF header is damaged.");
+
+        const double toMv = unit == "uv" || unit == "\xb5v" ? 0.001 : unit == "v" ? 1000.0 : 1.0;
+        s.gain = (physMax - physMin) / (digMax - digMin) * toMv;
+        s.offsetMv = (physMin - digMin * (physMax - physMin) / (digMax - digMin)) * toMv;
+        m_signals.append(s);
+    }
+
+    QVector<int> ordinary;
+    for (int i = 0; i < signalCount; ++i) {
+        const QString& label = m_signals[i].label;
+        if (label == "EDF Annotations") {
+            if (m_annotations < 0) m_annotations = i;
+            continue;
+        }
+        ordinary.append(i);
+        if (m_atrial < 0 && label.contains("atri", Qt::CaseInsensitive))
+            m_atrial = i;
+        else if (m_ventricular < 0 && label.contains("vent", Qt::CaseInsensitive))
+            m_ventricular = i;
+    }
+    if (ordinary.isEmpty())
+        return fail("EDF file has no signals.");
+    if (m_atrial < 0 && m_ventricular < 0) {
+        if (ordinary.size() == 1) {
+            m_ventricular = ordinary[0];
+        } else {
+            m_atrial = ordinary[0];
+            m_ventricular = ordinary[1];
+        }
+    }
+
+    m_spr = m_signals[m_ventricular >= 0 ? m_ventricular : m_atrial].samples;
+    if (m_atrial >= 0 && m_ventricular >= 0 && m_signals[m_atrial].samples != m_signals[m_ventricular].samples)
+        return fail("Atrial and ventricular signals have different sample rates.");
+    m_rateHz = qRound(m_spr / duration);
+    if (m_rateHz <= 0 || std::abs(m_rateHz * duration - m_spr) > 1e-6)
+        return fail("EDF sample rate is not a whole number of Hz.");
+
+    m_recordBytes = offset * 2;
+    m_buf.assign(static_cast<size_t>(m_recordBytes), 0);
+    if (m_recordCount < 0)
+        m_recordCount = (m_file.size() - headerBytes) / m_recordBytes;
+
+    // dd.mm.yy, with 1985 as the century pivot the standard prescribes.
+    const QList<QByteArray> date = field(general, 168, 8).split('.');
+    const QList<QByteArray> time = field(general, 176, 8).split('.');
+    if (date.size() == 3 && time.size() == 3) {
+        const int yy = date[2].toInt();
+        const QDateTime start(QDate(yy >= 85 ? 1900 + yy : 2000 + yy, date[1].toInt(), date[0].toInt()),
+                              QTime(time[0].toInt(), time[1].toInt(), time[2].toInt()));
+        m_startEpochMs = start.isValid() ? start.toMSecsSinceEpoch() : 0;
+    }
+    return true;
+}
+
+int Reader::readRecord(quint32* timeMs, float* atrial, float* ventricular,
+                       QVector<EgramMarker>* markers, QString* err)
+{
+    if (!m_file.isOpen() || m_nextRecord >= m_recordCount)
+        return 0;
+
+    const qint64 got = m_file.read(m_buf.data(), m_recordBytes);
+    if (got != m_recordBytes) {
+        // A torn last record ends the file; anything else is an error.
+        if (got < 0) {
+            if (err) *err = m_file.errorString();
+            return -1;
+        }
+        return 0;
+    }
+
+    const quint64 first = static_cast<quint64>(m_nextRecord) * static_cast<quint64>(m_spr);
+    ++m_nextRecord;
+
+    auto convert = [this](int index, float* out) {
+        const Signal& s = m_signals[index];
+        const char* d = m_buf.data() + 2 * s.offset;
+        for (int i = 0; i < m_spr; ++i)
+            out[i] = static_cast<float>(qFromLittleEndian<qint16>(d + 2 * i) * s.gain + s.offsetMv);
+    };
+    if (m_atrial >= 0)
+        convert(m_atrial, atrial);
+    else
+        std::fill(atrial, atrial + m_spr, 0.0f);
+    if (m_ventricular >= 0)
+        convert(m_ventricular, ventricular);
+    else
+        std::fill(ventricular, ventricular + m_spr, 0.0f);
+
+    for (int i = 0; i < m_spr; ++i)
+        timeMs[i] = static_cast<quint32>((first + static_cast<quint64>(i)) * 1000 / static_cast<quint64>(m_rateHz));
+
+    if (m_annotations >= 0 && markers) {
+        const Signal& s = m_signals[m_annotations];
+        parseAnnotations(m_buf.data() + 2 * s.offset, 2 * s.samples, markers);
+    }
+    return m_spr;
+}
+
+// TALs: "+onset[\x15duration]\x14text\x14[text\x14...]\0". The first TAL
+// of each record only keeps time and carries no text.
+void Reader::parseAnnotations(const char* data, int len, QVector<EgramMarker>* markers) const
+{
+    int p = 0;
+    while (p < len) {
+        if (data[p] != '+' && data[p] != '-') {
+            ++p;
+            continue;
+        }
+
+        const int onsetStart = p;
+        while (p < len && data[p] != '\x14' && data[p] != '\x15')
+            ++p;
+        const double onset = QByteArray(data + onsetStart, p - onsetStart).toDouble();
+        while (p < len && data[p] != '\x14')
+            ++p;                                   // skip any duration
+        ++p;
+
+        while (p < len && data[p] != '\0') {
+            const int textStart = p;
+            while (p < len && data[p] != '\x14')
+                ++p;
+            EgramMarker m;
+            if (markerKind(QByteArray(data + textStart, p - textStart), &m.kind)) {
+                m.timeMs = static_cast<quint32>(qMax<qint64>(0, qRound64(onset * 1000.0)));
+                markers->append(m);
+            }
+            ++p;
+        }
+        ++p;
+    }
+}
+
+// -------------------------------------------------------------
+// Conversions
+// -------------------------------------------------------------
+bool exportRecording(const EgramArchive& archive, const QString& edfPath, QString* err)
+{
+    Writer w;
+    if (!w.open(edfPath, archive.sampleRate(), archive.header().startEpochMs, err))
+        return false;
+
+    std::vector<quint32>     t(EgramFile::CHUNK_SAMPLES);
+    std::vector<float>       a(EgramFile::CHUNK_SAMPLES);
+    std::vector<float>       v(EgramFile::CHUNK_SAMPLES);
+    std::vector<EgramMarker> m(EgramFile::MAX_CHUNK_MARKERS);
+
+    for (int i = 0; i < archive.chunkCount(); ++i) {
+        int markerCount = 0;
+        const int n = archive.readChunk(i, t.data(), a.data(), v.data(), m.data(), &markerCount);
+        if (n < 0) {
+            w.finish();
+            if (err) *err = QString("Chunk %1 is damaged.").arg(i);
+            return false;
+        }
+
+        // Markers first, so each is written with the record it falls in.
+        for (int k = 0; k < markerCount; ++k)
+            w.appendMarker(m[static_cast<size_t>(k)]);
+        if (!w.append(t.data(), a.data(), v.data(), n))
+            break;
+    }
+    return w.finish(err);
+}
+
+bool importFile(const QString& edfPath, const QString& egrPath, QString* err)
+{
+    Reader r;
+    if (!r.open(edfPath, err))
+        return false;
+
+    EgramWriter w;
+    if (!w.open(egrPath, r.sampleRate(), r.startEpochMs(), err))
+        return false;
+
+    const size_t spr = static_cast<size_t>(r.samplesPerRecord());
+    std::vector<quint32> t(spr);
+    std::vector<float>   a(spr);
+    std::vector<float>   v(spr);
+    QVector<EgramMarker> markers;
+
+    int n;
+    while ((n = r.readRecord(t.data(), a.data(), v.data(), &markers, err)) > 0) {
+        if (!w.append(t.data(), a.data(), v.data(), n))
+            break;
+
+        // A record's markers go in after its samples, as the link queues them.
+        std::sort(markers.begin(), markers.end(),
+                  [](const EgramMarker& x, const EgramMarker& y) { return x.timeMs < y.timeMs; });
+        for (const EgramMarker& m : std::as_const(markers))
+            w.appendMarker(m);
+        markers.clear();
+    }
+    if (n < 0) {
+        w.finish();
+        return false;
+    }
+    return w.finish(err);
+}
+
+} // namespace EgramEdf
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+#include "egramdetector.h"   // EgramMarker
+#include "egramwriter.h"     // EgramSink
+
+class EgramArchive;
+
+// EDF+ (European Data Format) export and import of egram sessions.
+//
+// Exported files are EDF+C: one-second data records holding the atrial
+// and ventricular channels as 16-bit integers of 1 µV (±32.767 mV, the
+// same quantum as .egr), plus an "EDF Annotations" signal carrying one
+// TAL per marker ("AS", "AP", "VS", "VP") with its onset from the first
+// sample. Samples are taken as contiguous at the stream rate; device
+// timestamps are used only to place markers.
+//
+// Both directions stream one data record at a time, so memory stays fixed
+// however long the session.
+namespace EgramEdf {
+
+// Streaming EDF+ writer. Usable as a recorder sink for live sessions.
+class Writer : public EgramSink {
+public:
+    ~Writer() override;
+
+    // Writes the header with the record count left open (-1); finish()
+    // fills it in.
+    bool open(const QString& path, int sampleRateHz, qint64 startEpochMs, QString* err = nullptr) override;
+    bool isOpen() const override { return m_file.isOpen(); }
+
+    bool append(const quint32* timeMs, const float* atrial, const float* ventricular, int n) override;
+
+    // Written with the next data record that has room. False (and counted)
+    // if MAX_PENDING markers are already waiting.
+    bool appendMarker(const EgramMarker& marker) override;
+
+    // Pads and writes the last record, patches the record count, closes.
+    bool finish(QString* err = nullptr) override;
+    QString errorString() const override { return m_error; }
+
+    quint64 samplesWritten() const override { return m_written; }
+    quint64 markersWritten() const override { return m_markersWritten; }
+    quint64 markersDropped() const override { return m_markersDropped; }
+    quint64 chunksWritten() const override { return m_records; }
+    quint64 bytesWritten() const override { return m_bytes; }
+
+private:
+    static constexpr int ANNOT_BYTES = 256;    // per record: ~14 markers
+    static constexpr int MAX_PENDING = 1024;
+
+    bool writeRecord();
+    bool writeBytes(const char* data, qint64 len);
+
+    QFile   m_file;
+    QString m_error;
+    bool    m_failed{false};
+
+    int     m_spr{0};                // samples per channel per record
+    int     m_filled{0};
+    std::vector<qint16> m_record;    // atrial, ventricular, then annotation bytes
+    std::vector<EgramMarker> m_pending;
+
+    bool    m_haveFirst{false};
+    quint32 m_firstTimeMs{0};
+    quint64 m_records{0};
+    quint64 m_written{0};
+    quint64 m_markersWritten{0};
+    quint64 m_markersDropped{0};
+    quint64 m_bytes{0};
+};
+
+// Streaming EDF / EDF+C reader. The atrial and ventricular channels are
+// the first ordinary signals whose labels mention them, otherwise the
+// first two ordinary signals (a lone signal is read as ventricular).
+class Reader {
+public:
+    bool open(const QString& path, QString* err = nullptr);
+    void close() { m_file.close(); }
+
+    int     sampleRate() const { return m_rateHz; }
+    qint64  startEpochMs() const { return m_startEpochMs; }
+    qint64  recordCount() const { return m_recordCount; }
+    int     samplesPerRecord() const { return m_spr; }
+
+    // Next data record into arrays of samplesPerRecord(). Timestamps run
+    // from 0 ms at the first sample. Annotation markers are appended to
+    // markers. Returns the sample count, 0 at the end, or -1 on error.
+    int readRecord(quint32* timeMs, float* atrial, float* ventricular,
+                   QVector<EgramMarker>* markers, QString* err = nullptr);
+
+private:
+    struct Signal {
+        QString label;
+        int     offset{0};           // in samples within the record
+        int     samples{0};
+        double  gain{1.0};           // mV per digital unit
+        double  offsetMv{0.0};
+    };
+
+    void parseAnnotations(const char* data, int len, QVector<EgramMarker>* markers) const;
+
+    QFile   m_file;
+    int     m_rateHz{0};
+    qint64  m_startEpochMs{0};
+    qint64  m_recordCount{0};
+    qint64  m_nextRecord{0};
+    int     m_spr{0};
+    int     m_recordBytes{0};
+    int     m_atrial{-1};            // index into m_signals, -1 if absent
+    int     m_ventricular{-1};
+    int     m_annotations{-1};
+    QVector<Signal>   m_signals;
+    std::vector<char> m_buf;
+};
+
+// Whole-file conversions, streamed one chunk or record at a time.
+bool exportRecording(const EgramArchive& archive, const QString& edfPath, QString* err = nullptr);
+bool importFile(const QString& edfPath, const QString& egrPath, QString* err = nullptr);
+
+} // namespace EgramEdf
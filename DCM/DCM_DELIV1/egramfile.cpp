@@ -0,0 +1,306 @@
+#include "egramfile.h"
+
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+namespace EgramFile {
+
+namespace {
+// -------------------------------------------------------------
+// Varint helpers (LEB128, zigzag for signed values)
+// -------------------------------------------------------------
+inline quint8* putVarint(quint8* p, quint32 v)
+{
+    while (v >= 0x80) {
+        *p++ = static_cast<quint8>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<quint8>(v);
+    return p;
+}
+
+inline bool getVarint(const quint8*& p, const quint8* end, quint32* v)
+{
+    quint32 out = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const quint8 b = *p++;
+        out |= static_cast<quint32>(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = out;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline quint32 zigzag(qint32 v)   { return (static_cast<quint32>(v) << 1) ^ static_cast<quint32>(v >> 31); }
+inline qint32  unzigzag(quint32 v) { return static_cast<qint32>(v >> 1) ^ -static_cast<qint32>(v & 1); }
+
+inline qint32 toUnits(float mv)
+{
+    return static_cast<qint32>(std::lround(static_cast<double>(mv) * UNITS_PER_MV));
+}
+
+quint8* putChannel(quint8* p, const float* x, int n)
+{
+    qint32 prev = 0;
+    for (int i = 0; i < n; ++i) {
+        const qint32 q = toUnits(x[i]);
+        p = putVarint(p, zigzag(q - prev));
+        prev = q;
+    }
+    return p;
+}
+
+bool getChannel(const quint8*& p, const quint8* end, float* x, int n)
+{
+    qint32 prev = 0;
+    for (int i = 0; i < n; ++i) {
+        quint32 z;
+        if (!getVarint(p, end, &z))
+            return false;
+        prev += unzigzag(z);
+        x[i] = static_cast<float>(prev / UNITS_PER_MV);
+    }
+    return true;
+}
+
+// Summary records are SUMMARY_SIZE bytes: times, count, then min, max
+// and mean per channel as float32.
+inline void putSummary(const Summary& s, quint8* dst)
+{
+    qToLittleEndian<quint32>(s.firstTimeMs, dst);
+    qToLittleEndian<quint32>(s.lastTimeMs, dst + 4);
+    qToLittleEndian<quint32>(s.count, dst + 8);
+    for (int c = 0; c < 2; ++c) {
+        qToLittleEndian<float>(s.min[c],  dst + 12 + 4 * c);
+        qToLittleEndian<float>(s.max[c],  dst + 20 + 4 * c);
+        qToLittleEndian<float>(s.mean[c], dst + 28 + 4 * c);
+    }
+}
+
+inline void getSummary(const quint8* src, Summary* s)
+{
+    s->firstTimeMs = qFromLittleEndian<quint32>(src);
+    s->lastTimeMs  = qFromLittleEndian<quint32>(src + 4);
+    s->count       = qFromLittleEndian<quint32>(src + 8);
+    for (int c = 0; c < 2; ++c) {
+        s->min[c]  = qFromLittleEndian<float>(src + 12 + 4 * c);
+        s->max[c]  = qFromLittleEndian<float>(src + 20 + 4 * c);
+        s->mean[c] = qFromLittleEndian<float>(src + 28 + 4 * c);
+    }
+}
+}
+
+// -------------------------------------------------------------
+// Summaries
+// -------------------------------------------------------------
+void Summary::merge(const Summary& o)
+{
+    if (o.count == 0)
+        return;
+    if (count == 0) {
+        *this = o;
+        return;
+    }
+
+    const double total = static_cast<double>(count) + o.count;
+    for (int c = 0; c < 2; ++c) {
+        min[c] = qMin(min[c], o.min[c]);
+        max[c] = qMax(max[c], o.max[c]);
+        mean[c] = static_cast<float>((static_cast<double>(mean[c]) * count
+                                      + static_cast<double>(o.mean[c]) * o.count) / total);
+    }
+    lastTimeMs = o.lastTimeMs;
+    count += o.count;
+}
+
+void summarize(const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+               int blockSize, Summary* out)
+{
+    const float* ch[2] = { atrial, ventricular };
+
+    for (int b = 0, i = 0; i < n; ++b, i += blockSize) {
+        const int len = qMin(blockSize, n - i);
+        Summary& s = out[b];
+        s = Summary{};
+        s.firstTimeMs = timeMs[i];
+        s.lastTimeMs  = timeMs[i + len - 1];
+        s.count       = static_cast<quint32>(len);
+
+        for (int c = 0; c < 2; ++c) {
+            const float* x = ch[c] + i;
+            float mn = x[0];
+            float mx = x[0];
+            double sum = 0.0;
+            for (int k = 0; k < len; ++k) {
+                mn = qMin(mn, x[k]);
+                mx = qMax(mx, x[k]);
+                sum += x[k];
+            }
+            s.min[c]  = mn;
+            s.max[c]  = mx;
+            s.mean[c] = static_cast<float>(sum / len);
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// File header
+// -------------------------------------------------------------
+void writeHeader(const FileHeader& h, quint8* dst)
+{
+    std::memset(dst, 0, HEADER_SIZE);
+    qToLittleEndian<quint32>(FILE_MAGIC, dst);
+    qToLittleEndian<quint16>(VERSION, dst + 4);
+    qToLittleEndian<quint32>(h.sampleRateHz, dst + 8);
+    qToLittleEndian<qint64>(h.startEpochMs, dst + 12);
+}
+
+bool readHeader(const quint8* src, FileHeader* h)
+{
+    if (qFromLittleEndian<quint32>(src) != FILE_MAGIC
+        || qFromLittleEndian<quint16>(src + 4) != VERSION)
+        return false;
+
+    h->sampleRateHz = qFromLittleEndian<quint32>(src + 8);
+    h->startEpochMs = qFromLittleEndian<qint64>(src + 12);
+    return true;
+}
+
+// -------------------------------------------------------------
+// Chunks
+// -------------------------------------------------------------
+int encodeChunk(const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+                const EgramMarker* markers, int markerCount, quint8* dst, Summary* chunkSummary)
+{
+    const quint32 first = n > 0 ? timeMs[0] : 0;
+
+    Summary blocks[summaryCount(CHUNK_SAMPLES)];
+    const int nBlocks = summaryCount(n);
+    summarize(timeMs, atrial, ventricular, n, SUMMARY_BLOCK, blocks);
+
+    quint8* p = dst + CHUNK_HEADER_SIZE;
+    *chunkSummary = Summary{};
+    for (int b = 0; b < nBlocks; ++b) {
+        putSummary(blocks[b], p);
+        p += SUMMARY_SIZE;
+        chunkSummary->merge(blocks[b]);
+    }
+    quint8* const payloadStart = p;
+
+    for (int i = 1; i < n; ++i)
+        p = putVarint(p, timeMs[i] - timeMs[i - 1]);
+    p = putChannel(p, atrial, n);
+    p = putChannel(p, ventricular, n);
+
+    for (int i = 0; i < markerCount; ++i) {
+        const EgramMarker& m = markers[i];
+        p = putVarint(p, zigzag(static_cast<qint32>(m.timeMs - first)));
+        *p++ = m.kind;
+        p = putVarint(p, static_cast<quint32>(qBound(0, qRound(m.rateBpm * 10.0f), 0xFFFF)));
+    }
+
+    qToLittleEndian<quint32>(CHUNK_MAGIC, dst);
+    qToLittleEndian<quint32>(static_cast<quint32>(n), dst + 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(markerCount), dst + 8);
+    qToLittleEndian<quint32>(first, dst + 12);
+    qToLittleEndian<quint32>(n > 0 ? timeMs[n - 1] : 0, dst + 16);
+    qToLittleEndian<quint32>(static_cast<quint32>(nBlocks * SUMMARY_SIZE), dst + 20);
+    qToLittleEndian<quint32>(static_cast<quint32>(p - payloadStart), dst + 24);
+    return static_cast<int>(p - dst);
+}
+
+bool readChunkHeader(const quint8* chunk, ChunkHeader* h)
+{
+    if (qFromLittleEndian<quint32>(chunk) != CHUNK_MAGIC)
+        return false;
+
+    h->sampleCount  = qFromLittleEndian<quint32>(chunk + 4);
+    h->markerCount  = qFromLittleEndian<quint32>(chunk + 8);
+    h->firstTimeMs  = qFromLittleEndian<quint32>(chunk + 12);
+    h->lastTimeMs   = qFromLittleEndian<quint32>(chunk + 16);
+    h->summaryBytes = qFromLittleEndian<quint32>(chunk + 20);
+    h->payloadBytes = qFromLittleEndian<quint32>(chunk + 24);
+    return h->sampleCount <= static_cast<quint32>(CHUNK_SAMPLES)
+        && h->markerCount <= static_cast<quint32>(MAX_CHUNK_MARKERS)
+        && h->summaryBytes == static_cast<quint32>(summaryCount(static_cast<int>(h->sampleCount)) * SUMMARY_SIZE);
+}
+
+void readChunkSummaries(const ChunkHeader& h, const quint8* chunk, Summary* out)
+{
+    const int n = summaryCount(static_cast<int>(h.sampleCount));
+    for (int b = 0; b < n; ++b)
+        getSummary(chunk + CHUNK_HEADER_SIZE + b * SUMMARY_SIZE, &out[b]);
+}
+
+bool decodeChunk(const ChunkHeader& h, const quint8* chunk,
+                 quint32* timeMs, float* atrial, float* ventricular, EgramMarker* markers)
+{
+    const quint8* p = chunk + CHUNK_HEADER_SIZE + h.summaryBytes;
+    const quint8* end = p + h.payloadBytes;
+    const int n = static_cast<int>(h.sampleCount);
+
+    if (n > 0)
+        timeMs[0] = h.firstTimeMs;
+    for (int i = 1; i < n; ++i) {
+        quint32 d;
+        if (!getVarint(p, end, &d))
+            return false;
+        timeMs[i] = timeMs[i - 1] + d;
+    }
+
+    if (!getChannel(p, end, atrial, n) || !getChannel(p, end, ventricular, n))
+        return false;
+
+    for (quint32 i = 0; i < h.markerCount; ++i) {
+        quint32 dt;
+        quint32 rate;
+        if (!getVarint(p, end, &dt) || p >= end)
+            return false;
+        const quint8 kind = *p++;
+        if (!getVarint(p, end, &rate) || kind > EgramMarker::VentricularPace)
+            return false;
+
+        markers[i].timeMs  = h.firstTimeMs + static_cast<quint32>(unzigzag(dt));
+        markers[i].kind    = static_cast<EgramMarker::Kind>(kind);
+        markers[i].rateBpm = rate / 10.0f;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------
+// Index / trailer
+// -------------------------------------------------------------
+void writeIndexEntry(const IndexEntry& e, quint8* dst)
+{
+    qToLittleEndian<quint64>(e.offset, dst);
+    putSummary(e.summary, dst + 8);
+    qToLittleEndian<quint32>(0, dst + 8 + SUMMARY_SIZE);
+}
+
+void readIndexEntry(const quint8* src, IndexEntry* e)
+{
+    e->offset = qFromLittleEndian<quint64>(src);
+    getSummary(src + 8, &e->summary);
+}
+
+void writeTrailer(quint64 indexOffset, quint32 entries, quint8* dst)
+{
+    qToLittleEndian<quint64>(indexOffset, dst);
+    qToLittleEndian<quint32>(entries, dst + 8);
+    qToLittleEndian<quint32>(END_MAGIC, dst + 12);
+}
+
+bool readTrailer(const quint8* src, quint64* indexOffset, quint32* entries)
+{
+    if (qFromLittleEndian<quint32>(src + 12) != END_MAGIC)
+        return false;
+    *indexOffset = qFromLittleEndian<quint64>(src);
+    *entries = qFromLittleEndian<quint32>(src + 8);
+    return true;
+}
+
+} // namespace EgramFile
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <limits>
+
+#include "egramdetector.h"   // EgramMarker
+
+// On-disk egram recording (.egr), little-endian throughout.
+//
+//   FileHeader                                   HEADER_SIZE bytes
+//   { ChunkHeader, block summaries, payload }*   appended as the capture runs
+//   IndexEntry * n                               written on close
+//   Trailer                                      index offset, entry count, END_MAGIC
+//
+// Each chunk holds up to CHUNK_SAMPLES consecutive samples plus the
+// markers seen while they were collected (so a marker near a boundary
+// may sit in the chunk next to its sample). The payload is columnar:
+// timestamp deltas, then each channel as zigzag deltas of microvolt
+// integers, then the markers, all as LEB128 varints. A file without a
+// trailer (capture cut short) can still be read by walking the chunks.
+//
+// Level of detail: ahead of the payload every chunk carries a fixed-size
+// Summary per SUMMARY_BLOCK samples, and each index entry one for the
+// whole chunk, so a zoomed-out view reads summaries instead of decoding
+// samples. Coarser levels are built from the index when a file is opened.
+namespace EgramFile {
+
+constexpr quint32 FILE_MAGIC  = 0x4D524745;   // "EGRM"
+constexpr quint32 CHUNK_MAGIC = 0x4B4E4843;   // "CHNK"
+constexpr quint32 END_MAGIC   = 0x444E4545;   // "EEND"
+constexpr quint16 VERSION     = 2;            // 2: block summaries
+
+constexpr int HEADER_SIZE       = 32;
+constexpr int CHUNK_HEADER_SIZE = 28;
+constexpr int SUMMARY_SIZE      = 36;
+constexpr int INDEX_ENTRY_SIZE  = 8 + SUMMARY_SIZE + 4;
+constexpr int TRAILER_SIZE      = 16;
+
+constexpr int CHUNK_SAMPLES     = 4096;
+constexpr int MAX_CHUNK_MARKERS = 256;
+constexpr int SUMMARY_BLOCK     = 64;         // samples per stored block summary
+
+// Channel values are stored as integers of this many per mV (1 µV),
+// which is exact for packed egram frames.
+constexpr double UNITS_PER_MV = 1000.0;
+
+struct FileHeader {
+    quint32 sampleRateHz{0};
+    qint64  startEpochMs{0};     // wall clock when recording began
+};
+
+// Min/max/mean of both channels (0 = atrial, 1 = ventricular) over a run
+// of consecutive samples. Default-constructed it is empty and merges as
+// the identity.
+struct Summary {
+    quint32 firstTimeMs{0};
+    quint32 lastTimeMs{0};
+    quint32 count{0};
+    float   min[2]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float   max[2]{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    float   mean[2]{ 0.0f, 0.0f };
+
+    void merge(const Summary& o);
+};
+
+// Summarize n samples in runs of blockSize (the last may be short).
+// out must hold summaryCount(n, blockSize) entries.
+constexpr int summaryCount(int n, int blockSize = SUMMARY_BLOCK)
+{
+    return (n + blockSize - 1) / blockSize;
+}
+void summarize(const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+               int blockSize, Summary* out);
+
+struct ChunkHeader {
+    quint32 sampleCount{0};
+    quint32 markerCount{0};
+    quint32 firstTimeMs{0};
+    quint32 lastTimeMs{0};
+    quint32 summaryBytes{0};
+    quint32 payloadBytes{0};
+
+    quint32 totalBytes() const { return CHUNK_HEADER_SIZE + summaryBytes + payloadBytes; }
+};
+
+struct IndexEntry {
+    quint64 offset{0};           // file offset of the ChunkHeader
+    Summary summary;             // whole chunk; its times and count bound the chunk
+};
+
+void writeHeader(const FileHeader& h, quint8* dst);
+bool readHeader(const quint8* src, FileHeader* h);
+
+// Worst-case encoded size of one chunk, header and summaries included.
+constexpr int maxChunkBytes(int samples, int markers)
+{
+    return CHUNK_HEADER_SIZE + summaryCount(samples) * SUMMARY_SIZE
+         + samples * 3 * 5 + markers * (5 + 1 + 3);
+}
+
+// Encode a whole chunk into dst, which must hold maxChunkBytes(n,
+// markerCount). Returns the bytes written; chunkSummary receives the
+// summary of all n samples.
+int encodeChunk(const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+                const EgramMarker* markers, int markerCount, quint8* dst, Summary* chunkSummary);
+
+bool readChunkHeader(const quint8* chunk, ChunkHeader* h);
+
+// The chunk's block summaries, summaryCount(h.sampleCount) of them.
+void readChunkSummaries(const ChunkHeader& h, const quint8* chunk, Summary* out);
+
+// Decode the samples and markers of the chunk starting at chunk. False if
+// the payload is truncated or malformed.
+bool decodeChunk(const ChunkHeader& h, const quint8* chunk,
+                 quint32* timeMs, float* atrial, float* ventricular, EgramMarker* markers);
+
+void writeIndexEntry(const IndexEntry& e, quint8* dst);
+void readIndexEntry(const quint8* src, IndexEntry* e);
+
+void writeTrailer(quint64 indexOffset, quint32 entries, quint8* dst);
+bool readTrailer(const quint8* src, quint64* indexOffset, quint32* entries);
+
+} // namespace EgramFile
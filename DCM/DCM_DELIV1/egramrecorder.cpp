@@ -0,0 +1,174 @@
+#include "egramrecorder.h"
+#include "egramedf.h"
+
+#include <QDateTime>
+#include <QThread>
+
+namespace {
+// Producer-side slack: how far the disk may fall behind before samples
+// are dropped (16 s at 1 kHz), and likewise for markers.
+constexpr int SAMPLE_QUEUE = 16384;
+constexpr int MARKER_QUEUE = 1024;
+
+// Writer wake-up period. Well under what the queues can absorb.
+constexpr int WRITER_POLL_MS = 50;
+}
+
+// -------------------------------------------------------------
+// Construction
+// -------------------------------------------------------------
+EgramRecorder::EgramRecorder(QObject* parent)
+    : QObject(parent)
+    , m_samples(SAMPLE_QUEUE)
+    , m_markerQueue(MARKER_QUEUE)
+{
+}
+
+EgramRecorder::~EgramRecorder()
+{
+    stop();
+}
+
+// -------------------------------------------------------------
+// Start / stop (GUI thread)
+// -------------------------------------------------------------
+bool EgramRecorder::start(const QString& path, int sampleRateHz, QString* err)
+{
+    if (isRecording()) {
+        if (err) *err = "Already recording.";
+        return false;
+    }
+
+    if (path.endsWith(".edf", Qt::CaseInsensitive))
+        m_file = std::make_unique<EgramEdf::Writer>();
+    else
+        m_file = std::make_unique<EgramWriter>();
+    if (!m_file->open(path, sampleRateHz, QDateTime::currentMSecsSinceEpoch(), err))
+        return false;
+    m_path = path;
+
+    // Leftovers from a previous session must not leak into this file.
+    m_samples.discard();
+    EgramMarker stale;
+    while (m_markerQueue.pop(&stale)) {}
+
+    m_stopRequested = false;
+    m_failed = false;
+    publishStats();
+
+    m_writer = QThread::create([this]() { writerLoop(); });
+    m_writer->setObjectName("EgramRecorder");
+    m_writer->start(QThread::LowPriority);
+    return true;
+}
+
+void EgramRecorder::stop()
+{
+    if (!m_writer)
+        return;
+
+    m_stopRequested = true;
+    m_writer->wait();
+    delete m_writer;
+    m_writer = nullptr;
+}
+
+EgramRecorder::Stats EgramRecorder::stats() const
+{
+    Stats s;
+    s.samples = m_written.load(std::memory_order_relaxed);
+    s.markers = m_markersWritten.load(std::memory_order_relaxed);
+    s.dropped = m_samples.overflows() + m_markerQueue.overflows()
+              + m_markersDropped.load(std::memory_order_relaxed);
+    s.chunks  = m_chunks.load(std::memory_order_relaxed);
+    s.bytes   = m_bytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool EgramRecorder::writeFile(const QString& path, int sampleRateHz,
+                              const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+                              const EgramMarker* markers, int markerCount, QString* err)
+{
+    EgramWriter w;
+    if (!w.open(path, sampleRateHz, QDateTime::currentMSecsSinceEpoch(), err))
+        return false;
+
+    // Each marker follows the samples up to and including its own.
+    int i = 0;
+    for (int m = 0; m < markerCount; ++m) {
+        int upTo = i;
+        while (upTo < n && static_cast<qint32>(timeMs[upTo] - markers[m].timeMs) <= 0)
+            ++upTo;
+        w.append(timeMs + i, atrial + i, ventricular + i, upTo - i);
+        w.appendMarker(markers[m]);
+        i = upTo;
+    }
+    w.append(timeMs + i, atrial + i, ventricular + i, n - i);
+    return w.finish(err);
+}
+
+// -------------------------------------------------------------
+// Producer
+// -------------------------------------------------------------
+void EgramRecorder::append(const quint32* timeMs, const float* atrial, const float* ventricular, int n)
+{
+    m_samples.pushBlock(timeMs, atrial, ventricular, n);
+}
+
+void EgramRecorder::appendMarker(const EgramMarker& marker)
+{
+    m_markerQueue.push(marker);
+}
+
+// -------------------------------------------------------------
+// Writer thread
+// -------------------------------------------------------------
+void EgramRecorder::writerLoop()
+{
+    while (!m_stopRequested.load() && !m_failed.load()) {
+        drainQueues();
+        QThread::msleep(WRITER_POLL_MS);
+    }
+
+    // The producer was detached before stop(), so this catches the tail.
+    drainQueues();
+    if (!m_file->finish() && !m_failed.load())
+        fail();
+    publishStats();
+}
+
+void EgramRecorder::drainQueues()
+{
+    int got;
+    while (!m_failed.load()
+           && (got = m_samples.drain(m_time.data(), m_atrial.data(), m_ventricular.data(), DRAIN_CHUNK)) > 0) {
+        if (!m_file->append(m_time.data(), m_atrial.data(), m_ventricular.data(), got))
+            fail();
+    }
+
+    // Markers are queued after their samples, but the I/O thread keeps
+    // pushing while this runs: a marker popped here may belong to a sample
+    // the next drain picks up, and so land in the chunk before its own.
+    // The format allows that (see egramfile.h), and EgramArchive reads one
+    // chunk either side of a window to pick such markers up.
+    EgramMarker m;
+    while (m_markerQueue.pop(&m))
+        m_file->appendMarker(m);
+
+    publishStats();
+}
+
+void EgramRecorder::publishStats()
+{
+    m_written        = m_file->samplesWritten();
+    m_markersWritten = m_file->markersWritten();
+    m_markersDropped = m_file->markersDropped();
+    m_chunks         = m_file->chunksWritten();
+    m_bytes          = m_file->bytesWritten();
+}
+
+void EgramRecorder::fail()
+{
+    m_failed = true;
+    emit errorOccurred(QString("Recording stopped: %1").arg(m_file->errorString()));
+}
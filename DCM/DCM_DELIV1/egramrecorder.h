@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "egrambuffer.h"
+#include "egramdetector.h"
+#include "egramwriter.h"
+#include "spscqueue.h"
+
+class QThread;
+
+// Streams egram samples and markers to an .egr file (see egramfile.h).
+//
+// The producer (PacemakerLink's I/O thread, via setRecorder) only copies
+// into two bounded SPSC queues; a private writer thread drains them into
+// an EgramSink: an EgramWriter for .egr, or an EDF+ writer when the path
+// ends in .edf (see egramedf.h).
+// Everything is allocated in start(), so memory stays fixed however long
+// the capture runs, apart from one IndexEntry per chunk (48 bytes per
+// ~4 s at 1 kHz). If the disk falls behind, the producer drops samples
+// and counts them rather than waiting.
+class EgramRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 samples{0};       // written to chunks
+        quint64 markers{0};
+        quint64 dropped{0};       // samples + markers refused because a queue was full
+        quint64 chunks{0};        // .egr chunks, or EDF data records
+        quint64 bytes{0};         // file size so far
+    };
+
+    explicit EgramRecorder(QObject* parent = nullptr);
+    ~EgramRecorder() override;
+
+    // GUI thread. start() truncates path and writes the header; stop()
+    // writes what is still buffered (and the index), then closes the file.
+    bool start(const QString& path, int sampleRateHz, QString* err = nullptr);
+    void stop();
+    bool isRecording() const { return m_writer != nullptr; }
+    QString path() const { return m_path; }
+    Stats stats() const;
+
+    // Write a complete recording in one go, on the calling thread. For
+    // short, already-collected windows such as triggered captures.
+    static bool writeFile(const QString& path, int sampleRateHz,
+                          const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+                          const EgramMarker* markers, int markerCount, QString* err = nullptr);
+
+    // ---- Producer thread ----
+    void append(const quint32* timeMs, const float* atrial, const float* ventricular, int n);
+    void appendMarker(const EgramMarker& marker);
+
+signals:
+    // Emitted from the writer thread; recording stops at the first error.
+    void errorOccurred(const QString& msg);
+
+private:
+    // ---- Writer thread only ----
+    void writerLoop();
+    void drainQueues();
+    void publishStats();
+    void fail();
+
+    EgramBuffer            m_samples;
+    SpscQueue<EgramMarker> m_markerQueue;
+
+    QThread*          m_writer{nullptr};
+    std::atomic<bool> m_stopRequested{false};
+    std::atomic<bool> m_failed{false};
+
+    std::atomic<quint64> m_written{0};
+    std::atomic<quint64> m_markersWritten{0};
+    std::atomic<quint64> m_chunks{0};
+    std::atomic<quint64> m_bytes{0};
+    std::atomic<quint64> m_markersDropped{0};   // chunk held MAX_CHUNK_MARKERS already
+
+    QString                    m_path;
+    std::unique_ptr<EgramSink> m_file;
+
+    // Drain staging
+    static constexpr int DRAIN_CHUNK = 1024;
+    std::array<quint32, DRAIN_CHUNK> m_time{};
+    std::array<float, DRAIN_CHUNK>   m_atrial{};
+    std::array<float, DRAIN_CHUNK>   m_ventricular{};
+};
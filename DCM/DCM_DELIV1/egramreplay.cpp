@@ -0,0 +1,51 @@
+#include "egramreplay.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool EgramReplay::open(const QString& path, QString* err)
+{
+    m_chunk = 0;
+    m_pos = 0;
+    m_count = 0;
+    return m_archive.open(path, err);
+}
+
+bool EgramReplay::loadNextChunk()
+{
+    while (m_chunk < m_archive.chunkCount()) {
+        const int n = m_archive.readChunk(m_chunk++, m_time.data(), m_atrial.data(), m_ventricular.data());
+        if (n > 0) {
+            m_pos = 0;
+            m_count = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+int EgramReplay::read(quint32* timeMs, float* atrial, float* ventricular, int max, quint32 untilMs)
+{
+    const quint32 first = m_archive.firstTimeMs();
+    int out = 0;
+
+    while (out < max) {
+        if (m_pos == m_count && !loadNextChunk())
+            break;
+
+        // Timestamps ascend, so the due samples are a prefix of what is left.
+        const int avail = std::min(max - out, m_count - m_pos);
+        int n = 0;
+        while (n < avail && m_time[m_pos + n] - first <= untilMs)
+            ++n;
+        if (n == 0)
+            break;
+
+        std::memcpy(timeMs + out,      m_time.data() + m_pos,        sizeof(quint32) * n);
+        std::memcpy(atrial + out,      m_atrial.data() + m_pos,      sizeof(float) * n);
+        std::memcpy(ventricular + out, m_ventricular.data() + m_pos, sizeof(float) * n);
+        m_pos += n;
+        out += n;
+    }
+    return out;
+}
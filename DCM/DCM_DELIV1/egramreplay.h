@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QString>
+
+#include <array>
+
+#include "egramarchive.h"
+
+// Plays an .egr recording back as a sample source, one chunk decoded at a
+// time. PacemakerLink feeds what it returns into the same staging, filter,
+// detector and queue path that decoded frames take. Not thread-safe; the
+// link drives it from its I/O thread.
+class EgramReplay {
+public:
+    bool open(const QString& path, QString* err = nullptr);
+
+    int     sampleRate() const { return m_archive.sampleRate(); }
+    quint32 firstTimeMs() const { return m_archive.firstTimeMs(); }
+    quint64 sampleCount() const { return m_archive.sampleCount(); }
+    bool    atEnd() const { return m_pos == m_count && m_chunk >= m_archive.chunkCount(); }
+
+    // Copy up to max of the next samples, stopping at the first one more
+    // than untilMs after the start of the recording. Returns the number
+    // copied; 0 when nothing is due yet or the recording is over. A
+    // damaged chunk is skipped.
+    int read(quint32* timeMs, float* atrial, float* ventricular, int max,
+             quint32 untilMs = 0xFFFFFFFFu);
+
+private:
+    bool loadNextChunk();
+
+    EgramArchive m_archive;
+    int          m_chunk{0};      // next chunk to decode
+    int          m_pos{0};        // read position within the decoded chunk
+    int          m_count{0};      // samples in the decoded chunk
+
+    std::array<quint32, EgramFile::CHUNK_SAMPLES> m_time{};
+    std::array<float, EgramFile::CHUNK_SAMPLES>   m_atrial{};
+    std::array<float, EgramFile::CHUNK_SAMPLES>   m_ventricular{};
+};
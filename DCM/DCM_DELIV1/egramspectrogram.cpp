@@ -0,0 +1,206 @@
+#include "egramspectrogram.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr int DEFAULT_FFT_SIZE = 256;
+
+// Marked across both panes; the usual reason to open this view.
+constexpr double MAINS_HZ = 60.0;
+
+// Black -> blue -> magenta -> orange -> yellow, 256 steps.
+QRgb heat(int i)
+{
+    struct Stop { double at; int r, g, b; };
+    static const Stop STOPS[] = {
+        { 0.00,   0,   0,   0 },
+        { 0.25,  30,  20, 160 },
+        { 0.50, 180,  30, 150 },
+        { 0.75, 250, 130,  30 },
+        { 1.00, 255, 250, 170 },
+    };
+    const double x = i / 255.0;
+    int s = 0;
+    while (s < 3 && x > STOPS[s + 1].at)
+        ++s;
+    const Stop& a = STOPS[s];
+    const Stop& b = STOPS[s + 1];
+    const double f = (x - a.at) / (b.at - a.at);
+    return qRgb(qRound(a.r + f * (b.r - a.r)), qRound(a.g + f * (b.g - a.g)), qRound(a.b + f * (b.b - a.b)));
+}
+}
+
+// -------------------------------------------------------------
+// Construction / configuration
+// -------------------------------------------------------------
+EgramSpectrogram::EgramSpectrogram(QWidget* parent)
+    : QWidget(parent)
+    , fft_(std::make_unique<EgramDsp::Fft>(DEFAULT_FFT_SIZE))
+{
+    setMinimumSize(240, 200);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    for (int i = 0; i < 256; ++i)
+        palette_[static_cast<size_t>(i)] = heat(i);
+    rebuild();
+}
+
+void EgramSpectrogram::setSampleRate(int hz)
+{
+    sampleRate_ = qMax(1, hz);
+    rebuild();
+}
+
+void EgramSpectrogram::setFftSize(int size)
+{
+    fft_ = std::make_unique<EgramDsp::Fft>(qBound(64, size, 4096));
+    rebuild();
+}
+
+void EgramSpectrogram::setMaxFrequency(double hz)
+{
+    maxHz_ = qMax(1.0, hz);
+    rebuild();
+}
+
+void EgramSpectrogram::setDbRange(float floorDb, float ceilingDb)
+{
+    floorDb_ = floorDb;
+    ceilingDb_ = qMax(floorDb + 1.0f, ceilingDb);
+    clear();
+}
+
+void EgramSpectrogram::rebuild()
+{
+    const int n = fft_->size();
+    const double binHz = static_cast<double>(sampleRate_) / n;
+    rows_ = qBound(1, static_cast<int>(maxHz_ / binHz) + 1, fft_->bins());
+    hop_ = n / 4;
+
+    for (Channel& c : ch_) {
+        c.ring.assign(static_cast<size_t>(n), 0.0f);
+        c.frame.assign(static_cast<size_t>(n), 0.0f);
+        c.power.assign(static_cast<size_t>(fft_->bins()), 0.0f);
+        c.image = QImage(COLUMNS, rows_, QImage::Format_RGB32);
+    }
+    clear();
+}
+
+void EgramSpectrogram::clear()
+{
+    for (Channel& c : ch_) {
+        std::fill(c.ring.begin(), c.ring.end(), 0.0f);
+        c.image.fill(palette_[0]);
+    }
+    written_ = 0;
+    sinceHop_ = 0;
+    columnsDone_ = 0;
+    update();
+}
+
+// -------------------------------------------------------------
+// Streaming
+// -------------------------------------------------------------
+void EgramSpectrogram::append(const float* atrial, const float* ventricular, int n)
+{
+    if (!isVisible())
+        return;
+
+    const quint32 mask = static_cast<quint32>(fft_->size() - 1);
+    bool added = false;
+    for (int i = 0; i < n; ++i) {
+        const quint32 p = written_++ & mask;
+        ch_[Atrial].ring[p]      = atrial[i];
+        ch_[Ventricular].ring[p] = ventricular[i];
+
+        // The first window is only analysed once it is full.
+        if (++sinceHop_ >= hop_ && written_ >= static_cast<quint32>(fft_->size())) {
+            sinceHop_ = 0;
+            addColumn();
+            added = true;
+        }
+    }
+    if (added)
+        update();
+}
+
+void EgramSpectrogram::addColumn()
+{
+    const size_t size = static_cast<size_t>(fft_->size());
+    const size_t oldest = written_ & (size - 1);
+    for (Channel& c : ch_) {
+        std::memcpy(c.frame.data(), c.ring.data() + oldest, sizeof(float) * (size - oldest));
+        std::memcpy(c.frame.data() + (size - oldest), c.ring.data(), sizeof(float) * oldest);
+    }
+    fft_->powerSpectra(ch_[Atrial].frame.data(), ch_[Ventricular].frame.data(),
+                       ch_[Atrial].power.data(), ch_[Ventricular].power.data());
+
+    const int x = static_cast<int>(columnsDone_++ % COLUMNS);
+    const float scale = 255.0f / (ceilingDb_ - floorDb_);
+    for (Channel& c : ch_) {
+        for (int bin = 0; bin < rows_; ++bin) {
+            const float db = 10.0f * std::log10(c.power[static_cast<size_t>(bin)] + 1e-12f);
+            const int level = qBound(0, static_cast<int>((db - floorDb_) * scale), 255);
+            reinterpret_cast<QRgb*>(c.image.scanLine(rows_ - 1 - bin))[x] = palette_[static_cast<size_t>(level)];
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Painting
+// -------------------------------------------------------------
+QRect EgramSpectrogram::plotRect(int channel) const
+{
+    const int h = (height() - 3 * MARGIN) / ChannelCount;
+    return QRect(AXIS, MARGIN + channel * (h + MARGIN), qMax(1, width() - AXIS - MARGIN), qMax(1, h));
+}
+
+void EgramSpectrogram::paintEvent(QPaintEvent* event)
+{
+    QPainter p(this);
+    p.fillRect(event->rect(), Qt::white);
+
+    // Oldest column at the left: the ring is drawn in two pieces.
+    const int filled = static_cast<int>(qMin<quint32>(columnsDone_, COLUMNS));
+    const int head = static_cast<int>(columnsDone_ % COLUMNS);
+    const double binHz = static_cast<double>(sampleRate_) / fft_->size();
+    const double topHz = (rows_ - 1) * binHz;
+
+    static const char* const NAMES[ChannelCount] = { "A", "V" };
+    for (int i = 0; i < ChannelCount; ++i) {
+        const QRect pr = plotRect(i);
+        p.fillRect(pr, palette_[0]);
+
+        if (filled > 0) {
+            const double colW = static_cast<double>(pr.width()) / COLUMNS;
+            const int olderCols = filled == COLUMNS ? COLUMNS - head : 0;
+            const int newerCols = filled - olderCols;
+            const int x0 = pr.right() + 1 - qRound(filled * colW);
+            const int x1 = x0 + qRound(olderCols * colW);
+            if (olderCols > 0)
+                p.drawImage(QRect(x0, pr.top(), x1 - x0, pr.height()), ch_[i].image,
+                            QRect(head, 0, olderCols, rows_));
+            if (newerCols > 0)
+                p.drawImage(QRect(x1, pr.top(), pr.right() + 1 - x1, pr.height()), ch_[i].image,
+                            QRect(0, 0, newerCols, rows_));
+        }
+
+        p.setPen(Qt::black);
+        p.drawText(QRect(0, pr.top(), AXIS - 4, 16), Qt::AlignRight, NAMES[i]);
+        p.drawText(QRect(0, pr.top() + 14, AXIS - 4, 16), Qt::AlignRight,
+                   QString::number(qRound(topHz)));
+        p.drawText(QRect(0, pr.bottom() - 14, AXIS - 4, 16), Qt::AlignRight, "0 Hz");
+
+        if (MAINS_HZ < topHz) {
+            const int y = pr.bottom() - qRound(MAINS_HZ / topHz * (pr.height() - 1));
+            p.setPen(QPen(Qt::white, 1, Qt::DashLine));
+            p.drawLine(pr.left(), y, pr.right(), y);
+            p.setPen(Qt::black);
+            p.drawText(QRect(0, y - 8, AXIS - 4, 16), Qt::AlignRight | Qt::AlignVCenter, "60");
+        }
+    }
+}
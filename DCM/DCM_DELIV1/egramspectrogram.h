@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QImage>
+#include <QWidget>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "egramdsp.h"
+
+// Scrolling spectrogram of the two egram channels.
+//
+// Samples are pushed in by EgramWidget as it drains the link's queue. Every
+// hop (a quarter of the FFT size) the newest FFT-size window of both
+// channels goes through one EgramDsp::Fft::powerSpectra call, and the two
+// spectra become one new column of a per-channel heatmap image, written in
+// place in a column ring so nothing is shifted. Frequency runs up the
+// image, from 0 Hz to maxFrequency(); colour is power in dB between the
+// floor and ceiling. All buffers are sized when the FFT size or rate
+// changes, so append() allocates nothing. While hidden, append() returns
+// at once.
+class EgramSpectrogram : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit EgramSpectrogram(QWidget* parent = nullptr);
+
+    void setSampleRate(int hz);
+    void setFftSize(int size);               // power of two, 64..4096
+    int  fftSize() const { return fft_->size(); }
+
+    // Highest frequency shown, capped at Nyquist.
+    void setMaxFrequency(double hz);
+    double maxFrequency() const { return maxHz_; }
+
+    // Power (mV^2, dB) mapped to the bottom and top of the colour scale.
+    void setDbRange(float floorDb, float ceilingDb);
+
+    // Filtered samples, in stream order.
+    void append(const float* atrial, const float* ventricular, int n);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    enum { Atrial, Ventricular, ChannelCount };
+
+    struct Channel {
+        std::vector<float> ring;       // last fftSize samples
+        std::vector<float> frame;      // ring unrolled, oldest first
+        std::vector<float> power;      // one spectrum, bins() values
+        QImage image;                  // COLUMNS x rows, column ring
+    };
+
+    void rebuild();
+    void addColumn();
+    QRect plotRect(int channel) const;
+
+    static constexpr int COLUMNS = 512;
+    static constexpr int MARGIN  = 10;
+    static constexpr int AXIS    = 40;     // left gutter for frequency labels
+
+    std::unique_ptr<EgramDsp::Fft> fft_;
+    std::array<Channel, ChannelCount> ch_;
+    std::array<QRgb, 256> palette_{};
+
+    int     sampleRate_{1000};
+    double  maxHz_{150.0};
+    float   floorDb_{-60.0f};
+    float   ceilingDb_{10.0f};
+    int     rows_{1};                 // bins shown
+    int     hop_{1};
+    quint32 written_{0};              // samples appended, free-running
+    int     sinceHop_{0};
+    quint32 columnsDone_{0};          // free-running
+};
@@ -0,0 +1,99 @@
+#include "egramstats.h"
+
+// -------------------------------------------------------------
+// Configuration
+// -------------------------------------------------------------
+EgramStats::EgramStats()
+{
+    configure(Config{});
+}
+
+EgramStats::Config EgramStats::fromProfile(const Database::ModeProfile& p)
+{
+    Config c;
+    if (p.lrl && *p.lrl > 0)
+        c.lrlBpm = *p.lrl;
+    if (p.url && *p.url > 0)
+        c.urlBpm = *p.url;
+    return c;
+}
+
+void EgramStats::configure(const Config& config)
+{
+    // Kept normalised, so config() reports the bins actually in use.
+    m_config = config;
+    m_config.lrlBpm = qMax(1, m_config.lrlBpm);
+    m_config.urlBpm = qMax(m_config.lrlBpm + 1, m_config.urlBpm);
+
+    const int span = m_config.urlBpm - m_config.lrlBpm;
+    m_config.binBpm = qMax(qMax(1, m_config.binBpm), (span + MAX_BINS - 1) / MAX_BINS);
+    m_bins = (span + m_config.binBpm - 1) / m_config.binBpm;
+
+    reset();
+}
+
+void EgramStats::reset()
+{
+    m_atrial = Chamber{};
+    m_ventricular = Chamber{};
+    m_haveLastV = false;
+    m_intervals = 0;
+    m_rrSumMs = 0;
+    m_instantBpm = 0.0;
+    m_averageBpm = 0.0;
+    m_minBpm = 0.0;
+    m_maxBpm = 0.0;
+    m_histogram.fill(0);
+}
+
+int EgramStats::binLowerBpm(int i) const
+{
+    if (i <= 0)
+        return 0;
+    return qMin(m_config.lrlBpm + (i - 1) * m_config.binBpm, m_config.urlBpm);
+}
+
+// -------------------------------------------------------------
+// Update
+// -------------------------------------------------------------
+void EgramStats::addMarker(const EgramMarker& m)
+{
+    switch (m.kind) {
+    case EgramMarker::AtrialSense:      ++m_atrial.sensed; return;
+    case EgramMarker::AtrialPace:       ++m_atrial.paced; return;
+    case EgramMarker::VentricularSense: ++m_ventricular.sensed; break;
+    case EgramMarker::VentricularPace:  ++m_ventricular.paced; break;
+    }
+
+    // Unsigned difference stays correct across timestamp wrap; a backwards
+    // or overlong step (replay restart, dropped link) starts a new interval.
+    const quint32 rr = m.timeMs - m_lastVMs;
+    const bool counted = m_haveLastV && rr > 0 && rr <= MAX_RR_MS;
+    m_haveLastV = true;
+    m_lastVMs = m.timeMs;
+    if (!counted)
+        return;
+
+    const double bpm = 60000.0 / rr;
+    m_instantBpm = bpm;
+    if (m_intervals == 0) {
+        m_averageBpm = bpm;
+        m_minBpm = bpm;
+        m_maxBpm = bpm;
+    } else {
+        m_averageBpm += (bpm - m_averageBpm) / AVERAGE_BEATS;
+        m_minBpm = qMin(m_minBpm, bpm);
+        m_maxBpm = qMax(m_maxBpm, bpm);
+    }
+    ++m_intervals;
+    m_rrSumMs += rr;
+
+    int bin;
+    if (bpm < m_config.lrlBpm)
+        bin = 0;
+    else if (bpm >= m_config.urlBpm)
+        bin = m_bins + 1;
+    else
+        bin = 1 + static_cast<int>((bpm - m_config.lrlBpm) / m_config.binBpm);
+    ++m_histogram[static_cast<size_t>(bin)];
+}
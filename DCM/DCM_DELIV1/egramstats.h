@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+
+#include "database.h"        // Database::ModeProfile
+#include "egramdetector.h"   // EgramMarker
+
+// Running statistics over detected sense/pace events.
+//
+// Heart rate comes from successive ventricular events (sensed or paced):
+// the instantaneous rate of the last interval, an exponential average
+// over roughly the last AVERAGE_BEATS beats, the session mean and the
+// extremes. Each chamber counts its paced and sensed events. Every rate
+// also lands in a histogram whose bins span the programmed LRL..URL, with
+// one bin below LRL and one at or above URL.
+//
+// O(1) per event and no allocation, so every query is current. Lives on
+// PacemakerLink's I/O thread beside the detector, which feeds it every
+// marker; the GUI reads copies through PacemakerLink::egramStats().
+class EgramStats {
+public:
+    struct Config {
+        int lrlBpm{60};
+        int urlBpm{120};
+        int binBpm{5};      // widened if the range needs more than MAX_BINS
+    };
+
+    struct Chamber {
+        quint64 sensed{0};
+        quint64 paced{0};
+
+        quint64 total() const { return sensed + paced; }
+        double  pacedPercent() const { return total() ? 100.0 * paced / total() : 0.0; }
+    };
+
+    EgramStats();
+
+    // Rate limits from lrl/url; unset fields keep the defaults.
+    static Config fromProfile(const Database::ModeProfile& p);
+
+    // Clears everything and re-bins for the new range.
+    void configure(const Config& config);
+    void reset();
+
+    void addMarker(const EgramMarker& m);
+
+    const Chamber& atrial() const { return m_atrial; }
+    const Chamber& ventricular() const { return m_ventricular; }
+
+    // Rates in bpm; 0 until the first interval.
+    double  instantaneousBpm() const { return m_instantBpm; }
+    double  averageBpm() const { return m_averageBpm; }
+    double  meanBpm() const { return m_intervals ? 60000.0 * m_intervals / m_rrSumMs : 0.0; }
+    double  minBpm() const { return m_minBpm; }
+    double  maxBpm() const { return m_maxBpm; }
+    quint64 intervals() const { return m_intervals; }
+
+    // Bin 0 is below LRL and the last is at or above URL; bin i between
+    // covers [binLowerBpm(i), binLowerBpm(i + 1)).
+    int     binCount() const { return m_bins + 2; }
+    int     binLowerBpm(int i) const;
+    quint64 binAt(int i) const { return m_histogram[static_cast<size_t>(i)]; }
+    const Config& config() const { return m_config; }
+
+private:
+    static constexpr int MAX_BINS = 64;
+    static constexpr int AVERAGE_BEATS = 8;
+    // A longer gap is a stalled or restarted stream, not a beat.
+    static constexpr quint32 MAX_RR_MS = 6000;
+
+    Config  m_config;
+    int     m_bins{0};
+
+    Chamber m_atrial;
+    Chamber m_ventricular;
+
+    bool    m_haveLastV{false};
+    quint32 m_lastVMs{0};
+    quint64 m_intervals{0};
+    quint64 m_rrSumMs{0};
+    double  m_instantBpm{0.0};
+    double  m_averageBpm{0.0};
+    double  m_minBpm{0.0};
+    double  m_maxBpm{0.0};
+
+    std::array<quint64, MAX_BINS + 2> m_histogram{};
+};
@@ -0,0 +1,202 @@
+#include "egramtrigger.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+bool isVentricular(EgramMarker::Kind k)
+{
+    return k == EgramMarker::VentricularSense || k == EgramMarker::VentricularPace;
+}
+
+// First index in t[0..n) at or after timeMs; the last one if timeMs is
+// past the block.
+int indexAt(const quint32* t, int n, quint32 timeMs)
+{
+    for (int i = 0; i < n; ++i)
+        if (static_cast<qint32>(t[i] - timeMs) >= 0)
+            return i;
+    return n - 1;
+}
+}
+
+// -------------------------------------------------------------
+// Configuration
+// -------------------------------------------------------------
+void EgramTrigger::configure(const Config& config, int sampleRateHz)
+{
+    m_config = config;
+    m_config.preMs  = qBound(0, config.preMs, MAX_WINDOW_MS);
+    m_config.postMs = qBound(0, config.postMs, MAX_WINDOW_MS);
+    m_rateHz = qMax(1, sampleRateHz);
+
+    m_preSamples  = static_cast<int>(static_cast<qint64>(m_config.preMs) * m_rateHz / 1000);
+    m_postSamples = static_cast<int>(static_cast<qint64>(m_config.postMs) * m_rateHz / 1000);
+
+    // Room for the whole window plus the block that completes it.
+    quint32 cap = 1;
+    const quint32 need = static_cast<quint32>(m_preSamples + m_postSamples + MAX_BLOCK);
+    while (cap < need)
+        cap <<= 1;
+
+    if (m_config.source == Source::Off) {
+        m_time.clear();
+        m_atrial.clear();
+        m_ventricular.clear();
+        m_time.shrink_to_fit();
+        m_atrial.shrink_to_fit();
+        m_ventricular.shrink_to_fit();
+        m_mask = 0;
+    } else {
+        m_time.assign(cap, 0);
+        m_atrial.assign(cap, 0.0f);
+        m_ventricular.assign(cap, 0.0f);
+        m_mask = cap - 1;
+    }
+
+    m_armed = true;
+    reset();
+}
+
+void EgramTrigger::reset()
+{
+    m_written = 0;
+    m_markerCount = 0;
+    m_collecting = false;
+    m_havePrev = false;
+    m_haveBeat = false;
+    m_gapFired = false;
+}
+
+// -------------------------------------------------------------
+// Streaming
+// -------------------------------------------------------------
+bool EgramTrigger::process(const quint32* timeMs, const float* atrial, const float* ventricular,
+                           int n, const EgramMarker* markers, int markerCount)
+{
+    if (m_config.source == Source::Off || n <= 0)
+        return false;
+    n = qMin(n, MAX_BLOCK);
+
+    const quint64 blockStart = m_written;
+    const quint32 cap = m_mask + 1;
+    const quint32 pos = static_cast<quint32>(blockStart) & m_mask;
+    const int first = qMin(n, static_cast<int>(cap - pos));
+    std::memcpy(m_time.data() + pos,        timeMs,      sizeof(quint32) * first);
+    std::memcpy(m_atrial.data() + pos,      atrial,      sizeof(float) * first);
+    std::memcpy(m_ventricular.data() + pos, ventricular, sizeof(float) * first);
+    if (first < n) {
+        std::memcpy(m_time.data(),        timeMs + first,      sizeof(quint32) * (n - first));
+        std::memcpy(m_atrial.data(),      atrial + first,      sizeof(float) * (n - first));
+        std::memcpy(m_ventricular.data(), ventricular + first, sizeof(float) * (n - first));
+    }
+    m_written += static_cast<quint64>(n);
+
+    for (int i = 0; i < markerCount; ++i)
+        m_markers[m_markerCount++ % MARKER_RING] = markers[i];
+
+    // Always evaluated so threshold and missing-beat state stay current.
+    const int hit = findCondition(timeMs, atrial, ventricular, n, markers, markerCount);
+    if (hit >= 0 && m_armed && !m_collecting) {
+        m_collecting = true;
+        m_triggerIndex = blockStart + static_cast<quint64>(hit);
+        m_endIndex = m_triggerIndex + static_cast<quint64>(m_postSamples) + 1;
+    }
+
+    if (!m_collecting || m_written < m_endIndex)
+        return false;
+
+    buildCapture();
+    m_collecting = false;
+    m_armed = !m_config.singleShot;
+    return true;
+}
+
+// Offset in the block where the condition first holds, or -1.
+int EgramTrigger::findCondition(const quint32* timeMs, const float* atrial, const float* ventricular,
+                                int n, const EgramMarker* markers, int markerCount)
+{
+    switch (m_config.source) {
+    case Source::VentricularSense:
+    case Source::AtrialSense: {
+        const EgramMarker::Kind want = m_config.source == Source::VentricularSense
+                                     ? EgramMarker::VentricularSense : EgramMarker::AtrialSense;
+        for (int i = 0; i < markerCount; ++i)
+            if (markers[i].kind == want)
+                return indexAt(timeMs, n, markers[i].timeMs);
+        return -1;
+    }
+
+    case Source::Threshold: {
+        const float* x = m_config.ventricular ? ventricular : atrial;
+        const float level = m_config.levelMv;
+        float prev = m_havePrev ? m_prev : x[0];
+        int hit = -1;
+        for (int i = 0; i < n; ++i) {
+            const bool crossed = m_config.rising ? (prev < level && x[i] >= level)
+                                                 : (prev > level && x[i] <= level);
+            if (crossed) {
+                hit = i;
+                break;
+            }
+            prev = x[i];
+        }
+        m_prev = x[n - 1];
+        m_havePrev = true;
+        return hit;
+    }
+
+    case Source::MissingBeat: {
+        // A beat in this block closes the gap being timed.
+        for (int i = 0; i < markerCount; ++i) {
+            if (isVentricular(markers[i].kind)) {
+                m_lastBeatMs = markers[i].timeMs;
+                m_haveBeat = true;
+                m_gapFired = false;
+            }
+        }
+        if (!m_haveBeat || m_gapFired)
+            return -1;
+
+        const quint32 due = m_lastBeatMs + static_cast<quint32>(m_config.missingMs);
+        if (static_cast<qint32>(timeMs[n - 1] - due) < 0)
+            return -1;
+        m_gapFired = true;
+        return indexAt(timeMs, n, due);
+    }
+
+    case Source::Off:
+        break;
+    }
+    return -1;
+}
+
+void EgramTrigger::buildCapture()
+{
+    const quint64 oldest = m_written > m_mask + 1 ? m_written - (m_mask + 1) : 0;
+    const quint64 begin = std::max(oldest, m_triggerIndex >= static_cast<quint64>(m_preSamples)
+                                               ? m_triggerIndex - static_cast<quint64>(m_preSamples) : 0);
+    const int n = static_cast<int>(m_endIndex - begin);
+
+    m_capture = EgramCapture{};
+    m_capture.triggerTimeMs = m_time[static_cast<quint32>(m_triggerIndex) & m_mask];
+    m_capture.sampleRateHz = m_rateHz;
+    m_capture.timeMs.resize(n);
+    m_capture.atrial.resize(n);
+    m_capture.ventricular.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const quint32 p = static_cast<quint32>(begin + static_cast<quint64>(i)) & m_mask;
+        m_capture.timeMs[i]      = m_time[p];
+        m_capture.atrial[i]      = m_atrial[p];
+        m_capture.ventricular[i] = m_ventricular[p];
+    }
+
+    const quint32 from = m_capture.timeMs.first();
+    const quint32 to = m_capture.timeMs.last();
+    const quint32 kept = qMin<quint32>(m_markerCount, MARKER_RING);
+    for (quint32 k = m_markerCount - kept; k != m_markerCount; ++k) {
+        const EgramMarker& m = m_markers[k % MARKER_RING];
+        if (static_cast<qint32>(m.timeMs - from) >= 0 && static_cast<qint32>(to - m.timeMs) >= 0)
+            m_capture.markers.append(m);
+    }
+}
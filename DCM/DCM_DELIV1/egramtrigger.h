@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "egramdetector.h"   // EgramMarker
+
+// A frozen window of egram around one trigger.
+struct EgramCapture {
+    quint32              triggerTimeMs{0};
+    int                  sampleRateHz{0};
+    QVector<quint32>     timeMs;
+    QVector<float>       atrial;
+    QVector<float>       ventricular;
+    QVector<EgramMarker> markers;
+};
+
+// Oscilloscope-style trigger over the filtered egram stream.
+//
+// While armed, the last preMs of samples sit in a fixed ring sized at
+// configure(). When the condition fires, collection continues for postMs
+// and the whole pre + post window is handed out as an EgramCapture; the
+// stream itself is never held up. Conditions are checked once per block
+// (markers) or with one compare per sample (threshold), so the cost is a
+// block copy into the ring plus at most one pass over one channel.
+//
+// PacemakerLink runs it on its I/O thread after the detector; not
+// thread-safe.
+class EgramTrigger {
+public:
+    enum class Source {
+        Off,
+        VentricularSense,   // a sensed ventricular marker
+        AtrialSense,        // a sensed atrial marker
+        Threshold,          // a channel crossing levelMv
+        MissingBeat,        // no ventricular event for missingMs
+    };
+
+    struct Config {
+        Source source{Source::Off};
+        int    preMs{1000};
+        int    postMs{2000};
+        bool   ventricular{true};    // Threshold: channel to watch
+        float  levelMv{1.0f};
+        bool   rising{true};
+        int    missingMs{1500};
+        bool   singleShot{false};    // disarm after one capture
+    };
+
+    // Longest block process() accepts, and longest pre / post window.
+    static constexpr int MAX_BLOCK = 1024;
+    static constexpr int MAX_WINDOW_MS = 10000;
+
+    void configure(const Config& config, int sampleRateHz);
+    const Config& config() const { return m_config; }
+    void reset();
+
+    bool isArmed() const { return m_config.source != Source::Off && m_armed; }
+    void arm() { m_armed = true; }
+
+    // Feed one filtered block (n <= MAX_BLOCK) and the markers found in
+    // it. Returns true when a capture completed; collect it with
+    // takeCapture() before the next call.
+    bool process(const quint32* timeMs, const float* atrial, const float* ventricular, int n,
+                 const EgramMarker* markers, int markerCount);
+    EgramCapture takeCapture() { return std::move(m_capture); }
+
+private:
+    static constexpr int MARKER_RING = 64;
+
+    int  findCondition(const quint32* timeMs, const float* atrial, const float* ventricular,
+                       int n, const EgramMarker* markers, int markerCount);
+    void buildCapture();
+
+    Config m_config;
+    int    m_rateHz{1000};
+    int    m_preSamples{0};
+    int    m_postSamples{0};
+    bool   m_armed{true};
+
+    // Sample ring; indices are free-running sample counts.
+    std::vector<quint32> m_time;
+    std::vector<float>   m_atrial;
+    std::vector<float>   m_ventricular;
+    quint32 m_mask{0};
+    quint64 m_written{0};
+
+    std::array<EgramMarker, MARKER_RING> m_markers{};
+    quint32 m_markerCount{0};
+
+    bool    m_collecting{false};
+    quint64 m_triggerIndex{0};
+    quint64 m_endIndex{0};
+
+    // Threshold: last sample of the watched channel.
+    float m_prev{0.0f};
+    bool  m_havePrev{false};
+
+    // Missing beat: last ventricular event, and whether this gap fired.
+    quint32 m_lastBeatMs{0};
+    bool    m_haveBeat{false};
+    bool    m_gapFired{false};
+
+    EgramCapture m_capture;
+};
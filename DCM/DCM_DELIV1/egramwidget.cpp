@@ -0,0 +1,706 @@
+#include "egramwidget.h"
+#include "egramarchive.h"
+#include "egrambuffer.h"
+#include "egramspectrogram.h"
+
+#include <QElapsedTimer>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QScreen>
+#include <QtMath>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr float EMPTY_MIN = std::numeric_limits<float>::max();
+constexpr float EMPTY_MAX = -std::numeric_limits<float>::max();
+
+// Samples pulled from the queue per drain() call.
+constexpr int DRAIN_CHUNK = 512;
+
+// Used when the screen does not report its refresh rate.
+constexpr double FALLBACK_REFRESH_HZ = 60.0;
+
+const QRgb BACKGROUND = qRgb(255, 255, 255);
+const QRgb BASELINE   = qRgb(160, 160, 160);
+}
+
+// -------------------------------------------------------------
+// Construction / configuration
+// -------------------------------------------------------------
+EgramWidget::EgramWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    setMinimumHeight(200);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    for (Channel& c : ch_)
+        c.history.assign(HISTORY, 0.0f);
+    timeHistory_.assign(HISTORY, 0);
+    ch_[Atrial].color      = qRgb(220, 0, 0);
+    ch_[Ventricular].color = qRgb(0, 0, 220);
+    rebuildColumns();
+
+    frameTimer_ = new QTimer(this);
+    frameTimer_->setSingleShot(true);
+    frameTimer_->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer_, &QTimer::timeout, this, [this]() { tick(); });
+}
+
+void EgramWidget::setSampleRate(int hz)
+{
+    sampleRate_ = qMax(1, hz);
+    rebuildColumns();
+}
+
+void EgramWidget::setTimeWindow(double seconds)
+{
+    windowSec_ = qMax(0.1, seconds);
+    if (archive_)
+        showArchiveAt(archiveStartMs_);
+    else
+        rebuildColumns();
+}
+
+void EgramWidget::setRange(float mv)
+{
+    rangeMv_ = qMax(0.01f, mv);
+    renderAll();
+    update();
+}
+
+void EgramWidget::setDisplayMode(DisplayMode mode)
+{
+    mode_ = mode;
+    renderAll();
+    update();
+}
+
+void EgramWidget::setCpuBudget(double fraction)
+{
+    cpuBudget_ = qBound(0.001, fraction, 1.0);
+}
+
+double EgramWidget::frameRate() const
+{
+    return 1000.0 / qMax(1, frameIntervalMs());
+}
+
+void EgramWidget::clear()
+{
+    for (Channel& c : ch_)
+        std::fill(c.history.begin(), c.history.end(), 0.0f);
+    written_ = 0;
+    markerCount_ = 0;
+    hasPendingMarker_ = false;
+    rebuildColumns();
+}
+
+void EgramWidget::setArchive(const EgramArchive* archive)
+{
+    archive_ = archive && archive->isOpen() ? archive : nullptr;
+    frameTimer_->stop();
+
+    if (archive_) {
+        sampleRate_ = archive_->sampleRate();
+        showArchiveAt(archive_->firstTimeMs());
+        return;
+    }
+
+    // Back to live. What queued up while browsing is stale.
+    if (source_)
+        source_->discard();
+    if (markerSource_) {
+        EgramMarker stale;
+        while (markerSource_->pop(&stale)) {}
+    }
+    clear();
+}
+
+void EgramWidget::showArchiveAt(quint32 startMs)
+{
+    if (!archive_)
+        return;
+    archiveStartMs_ = startMs;
+
+    const quint32 spanMs = static_cast<quint32>(std::lround(windowSec_ * 1000.0));
+    const double spanSamples = spanMs * static_cast<double>(sampleRate_) / 1000.0;
+    const int plotWidth = qMax(1, width() - 2 * MARGIN);
+    if (spanSamples > HISTORY || spanSamples / plotWidth >= EgramFile::SUMMARY_BLOCK) {
+        showArchiveSummary(startMs, spanMs);
+        return;
+    }
+
+    EgramArchive::Window w;
+    archive_->read(startMs, startMs + spanMs - 1, &w);   // a damaged chunk shows as a gap
+
+    written_ = 0;
+    markerCount_ = 0;
+    hasPendingMarker_ = false;
+
+    const int n = qMin(w.timeMs.size(), HISTORY);
+    appendSamples(w.timeMs.constData(), w.atrial.constData(), w.ventricular.constData(), n);
+    for (const EgramMarker& m : std::as_const(w.markers))
+        placeMarker(m);
+
+    rebuildColumns();
+}
+
+// Zoomed-out archive view: one bucket per column or finer, folded into
+// columns by time. No raw samples or markers at this scale.
+void EgramWidget::showArchiveSummary(quint32 startMs, quint32 spanMs)
+{
+    columns_ = qMax(1, width() - 2 * MARGIN);
+    const double msPerColumn = static_cast<double>(spanMs) / columns_;
+    samplesPerColumn_ = qMax(1, static_cast<int>(msPerColumn * sampleRate_ / 1000.0));
+
+    QVector<EgramFile::Summary> buckets;
+    archive_->readSummaries(startMs, startMs + spanMs - 1, samplesPerColumn_, &buckets);
+
+    written_ = 0;
+    markerCount_ = 0;
+    hasPendingMarker_ = false;
+    inColumn_ = 0;
+    colsDone_ = static_cast<quint32>(columns_);
+    resetColumns();
+
+    for (const EgramFile::Summary& b : std::as_const(buckets)) {
+        const quint32 t = qMax(b.firstTimeMs, startMs);
+        const int col = static_cast<int>((t - startMs) / msPerColumn);
+        if (col >= columns_)
+            continue;
+        for (int i = 0; i < ChannelCount; ++i) {
+            ch_[i].colMin[col] = qMin(ch_[i].colMin[col], b.min[i]);
+            ch_[i].colMax[col] = qMax(ch_[i].colMax[col], b.max[i]);
+        }
+    }
+
+    renderAll();
+    update();
+}
+
+void EgramWidget::wheelEvent(QWheelEvent* event)
+{
+    const int delta = event->angleDelta().y();
+    if (!archive_ || delta == 0) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+
+    // 2x per notch, keeping the time under the cursor in place.
+    const double first = archive_->firstTimeMs();
+    const double total = static_cast<double>(archive_->lastTimeMs() - archive_->firstTimeMs()) + 1.0;
+    const double oldSpan = windowSec_ * 1000.0;
+    const double newSpan = qBound(100.0, oldSpan * std::pow(2.0, -delta / 120.0), qMax(100.0, total));
+
+    const QRect plot = plotRect(Atrial);
+    const double frac = qBound(0.0, (event->position().x() - plot.left()) / qMax(1, plot.width()), 1.0);
+    const double anchor = archiveStartMs_ + frac * oldSpan;
+    const double start = qBound(first, anchor - frac * newSpan, qMax(first, first + total - newSpan));
+
+    windowSec_ = newSpan / 1000.0;
+    showArchiveAt(static_cast<quint32>(start));
+    emit archiveViewChanged(archiveStartMs_, windowSec_);
+    event->accept();
+}
+
+// -------------------------------------------------------------
+// Frame scheduling
+// -------------------------------------------------------------
+void EgramWidget::dataAvailable()
+{
+    // Already ticking, or nobody to draw for: the next tick (or the next
+    // showEvent) picks the samples up.
+    if (!frameTimer_->isActive() && canRender())
+        scheduleFrame();
+}
+
+bool EgramWidget::canRender() const
+{
+    return source_ && !archive_ && isVisible() && !window()->isMinimized();
+}
+
+void EgramWidget::scheduleFrame()
+{
+    frameTimer_->start(frameIntervalMs());
+}
+
+int EgramWidget::frameIntervalMs() const
+{
+    if (unthrottled_)
+        return 0;
+
+    const QScreen* s = screen();
+    const double refreshHz = s && s->refreshRate() > 1.0 ? s->refreshRate() : FALLBACK_REFRESH_HZ;
+
+    // Spend at most cpuBudget_ of the time between frames on a frame.
+    const double costMs = (avgTickUs_ + avgPaintUs_) / 1000.0;
+    return qMax(qCeil(1000.0 / refreshHz), qCeil(costMs / cpuBudget_));
+}
+
+void EgramWidget::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    if (canRender())
+        tick();
+}
+
+void EgramWidget::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    frameTimer_->stop();
+}
+
+// -------------------------------------------------------------
+// Sample intake
+// -------------------------------------------------------------
+void EgramWidget::tick()
+{
+    if (!canRender())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const quint32 before = written_;
+    drainSource();
+    const bool placed = drainMarkers();
+    if (written_ == before)
+        return;                       // stream stopped: idle until woken
+
+    QRect dirty = renderNewColumns();
+    if (placed)                       // a marker may land on an older column
+        dirty = dirty.united(plotRect(Atrial).united(plotRect(Ventricular)));
+    update(dirty);
+
+    avgTickUs_ = 0.9 * avgTickUs_ + 0.1 * static_cast<double>(timer.nsecsElapsed() / 1000);
+    scheduleFrame();
+}
+
+void EgramWidget::drainSource()
+{
+    if (!source_)
+        return;
+
+    quint32 t[DRAIN_CHUNK];
+    float a[DRAIN_CHUNK];
+    float v[DRAIN_CHUNK];
+    int n;
+    while ((n = source_->drain(t, a, v, DRAIN_CHUNK)) > 0) {
+        appendSamples(t, a, v, n);
+        if (spectrogram_)
+            spectrogram_->append(a, v, n);
+    }
+}
+
+// Pin each marker to the sample it fired on by searching the timestamp
+// history. Markers are queued after their samples, so one that is newer
+// than everything drained waits for the next tick.
+bool EgramWidget::drainMarkers()
+{
+    if (!markerSource_ || written_ == 0)
+        return false;
+
+    const quint32 newestTime = timeHistory_[(written_ - 1) & (HISTORY - 1)];
+    bool placed = false;
+
+    for (;;) {
+        EgramMarker m;
+        if (hasPendingMarker_) {
+            m = pendingMarker_;
+        } else if (!markerSource_->pop(&m)) {
+            break;
+        }
+
+        if (static_cast<qint32>(m.timeMs - newestTime) > 0) {
+            pendingMarker_ = m;
+            hasPendingMarker_ = true;
+            break;
+        }
+        hasPendingMarker_ = false;
+
+        if (placeMarker(m))
+            placed = true;
+    }
+    return placed;
+}
+
+// Pin m to the first sample at or after its time (timestamps ascend).
+// False if that sample is not in the history.
+bool EgramWidget::placeMarker(const EgramMarker& m)
+{
+    const quint32 avail = qMin<quint32>(written_, HISTORY);
+    quint32 lo = written_ - avail;
+    quint32 hi = written_;
+    while (lo < hi) {
+        const quint32 mid = lo + (hi - lo) / 2;
+        if (static_cast<qint32>(timeHistory_[mid & (HISTORY - 1)] - m.timeMs) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == written_)
+        return false;
+
+    markers_[markerCount_++ & (MARKERS - 1)] = { lo, m.kind };
+    return true;
+}
+
+void EgramWidget::appendSamples(const quint32* timeMs, const float* atrial,
+                                const float* ventricular, int n)
+{
+    Channel& ca = ch_[Atrial];
+    Channel& cv = ch_[Ventricular];
+
+    for (int i = 0; i < n; ++i) {
+        const quint32 pos = written_++ & (HISTORY - 1);
+        timeHistory_[pos] = timeMs[i];
+        ca.history[pos] = atrial[i];
+        cv.history[pos] = ventricular[i];
+
+        ca.curMin = qMin(ca.curMin, atrial[i]);
+        ca.curMax = qMax(ca.curMax, atrial[i]);
+        cv.curMin = qMin(cv.curMin, ventricular[i]);
+        cv.curMax = qMax(cv.curMax, ventricular[i]);
+
+        if (++inColumn_ == samplesPerColumn_)
+            closeColumn();
+    }
+}
+
+void EgramWidget::closeColumn()
+{
+    const quint32 slot = colsDone_++ % static_cast<quint32>(columns_);
+    for (Channel& c : ch_) {
+        c.colMin[slot] = c.curMin;
+        c.colMax[slot] = c.curMax;
+        c.curMin = EMPTY_MIN;
+        c.curMax = EMPTY_MAX;
+    }
+    inColumn_ = 0;
+}
+
+// Re-derive every column from the raw history. Only runs when the
+// geometry changes, never per tick.
+void EgramWidget::rebuildColumns()
+{
+    const int plotWidth = qMax(1, width() - 2 * MARGIN);
+    const int windowSamples = qBound(1, static_cast<int>(std::lround(windowSec_ * sampleRate_)), HISTORY);
+
+    samplesPerColumn_ = qMax(1, (windowSamples + plotWidth - 1) / plotWidth);
+    columns_ = qMax(1, qMin(plotWidth, windowSamples / samplesPerColumn_));
+
+    resetColumns();
+
+    // Column boundaries are fixed multiples of samplesPerColumn_ in the
+    // free-running sample count, so incremental updates line up with this.
+    colsDone_ = written_ / static_cast<quint32>(samplesPerColumn_);
+    inColumn_ = static_cast<int>(written_ % static_cast<quint32>(samplesPerColumn_));
+
+    const quint32 avail = qMin<quint32>(written_, HISTORY);
+    const quint32 oldest = written_ - avail;
+
+    for (int back = columns_; back >= 0; --back) {
+        // back == 0 is the partial column; the rest are finished ones.
+        const quint32 col = colsDone_ - static_cast<quint32>(back);
+        if (back > static_cast<int>(colsDone_))
+            continue;
+
+        const quint32 begin = col * static_cast<quint32>(samplesPerColumn_);
+        const quint32 end = back == 0 ? written_ : begin + static_cast<quint32>(samplesPerColumn_);
+        if (begin < oldest)
+            continue;
+
+        for (Channel& c : ch_) {
+            float mn = EMPTY_MIN;
+            float mx = EMPTY_MAX;
+            for (quint32 s = begin; s < end; ++s) {
+                const float x = c.history[s & (HISTORY - 1)];
+                mn = qMin(mn, x);
+                mx = qMax(mx, x);
+            }
+            if (back == 0) {
+                c.curMin = mn;
+                c.curMax = mx;
+            } else {
+                const quint32 slot = col % static_cast<quint32>(columns_);
+                c.colMin[slot] = mn;
+                c.colMax[slot] = mx;
+            }
+        }
+    }
+
+    renderAll();
+    update();
+}
+
+// Empty column rings and images sized for columns_.
+void EgramWidget::resetColumns()
+{
+    for (int i = 0; i < ChannelCount; ++i) {
+        Channel& c = ch_[i];
+        c.colMin.assign(columns_, EMPTY_MIN);
+        c.colMax.assign(columns_, EMPTY_MAX);
+        c.curMin = EMPTY_MIN;
+        c.curMax = EMPTY_MAX;
+        c.image = QImage(columns_, qMax(1, plotRect(i).height()), QImage::Format_RGB32);
+    }
+}
+
+// -------------------------------------------------------------
+// Backing images
+// -------------------------------------------------------------
+QRect EgramWidget::plotRect(int channel) const
+{
+    const int half = height() / 2;
+    const int left = width() - MARGIN - columns_;
+    return channel == Atrial ? QRect(left, 0, columns_, half)
+                             : QRect(left, half, columns_, height() - half);
+}
+
+int EgramWidget::columnX(quint32 col) const
+{
+    // Scroll: newest finished column at the right edge of the image.
+    // Sweep: fixed slot, wrapping around.
+    if (mode_ == DisplayMode::Scroll)
+        return columns_ - 1 - static_cast<int>(colsDone_ - 1 - col);
+    return static_cast<int>(col % static_cast<quint32>(columns_));
+}
+
+namespace {
+// Clear one image column to background with a dashed baseline; dashKey
+// decides the dash phase so the pattern travels with the data.
+void clearColumn(QImage& img, int x, quint32 dashKey)
+{
+    const int h = img.height();
+    for (int y = 0; y < h; ++y)
+        reinterpret_cast<QRgb*>(img.scanLine(y))[x] = BACKGROUND;
+    if (((dashKey >> 2) & 1) == 0)
+        reinterpret_cast<QRgb*>(img.scanLine(h / 2))[x] = BASELINE;
+}
+}
+
+void EgramWidget::renderColumn(Channel& c, quint32 col)
+{
+    const int x = columnX(col);
+    QImage& img = c.image;
+    clearColumn(img, x, mode_ == DisplayMode::Scroll ? col : static_cast<quint32>(x));
+
+    const quint32 cols = static_cast<quint32>(columns_);
+    const quint32 slot = col % cols;
+    const float mn = c.colMin[slot];
+    const float mx = c.colMax[slot];
+    if (mn > mx)                              // no data for this column
+        return;
+
+    // Stretch to touch the previous column so steep edges stay connected.
+    float lo = mn;
+    float hi = mx;
+    if (col > 0 && colsDone_ - (col - 1) <= cols) {
+        const quint32 prev = (col - 1) % cols;
+        if (c.colMin[prev] <= c.colMax[prev]) {
+            lo = qMin(lo, c.colMax[prev]);
+            hi = qMax(hi, c.colMin[prev]);
+        }
+    }
+
+    const int h = img.height();
+    const float mid = h / 2.0f;
+    const float scale = (h / 2.0f - 2.0f) / rangeMv_;
+    const int y0 = qBound(0, static_cast<int>(mid - hi * scale), h - 1);
+    const int y1 = qBound(0, static_cast<int>(mid - lo * scale), h - 1);
+
+    for (int y = y0; y <= y1; ++y)
+        reinterpret_cast<QRgb*>(img.scanLine(y))[x] = c.color;
+}
+
+void EgramWidget::scrollImages(int n)
+{
+    const size_t keep = sizeof(QRgb) * static_cast<size_t>(columns_ - n);
+    for (Channel& c : ch_) {
+        for (int y = 0; y < c.image.height(); ++y) {
+            uchar* line = c.image.scanLine(y);
+            std::memmove(line, line + sizeof(QRgb) * n, keep);
+        }
+    }
+}
+
+void EgramWidget::eraseAhead(quint32 col)
+{
+    for (int k = 1; k <= qMin(ERASE_BAR, columns_ - 1); ++k) {
+        const int x = static_cast<int>((col + k) % static_cast<quint32>(columns_));
+        for (Channel& c : ch_)
+            clearColumn(c.image, x, static_cast<quint32>(x));
+    }
+}
+
+void EgramWidget::renderAll()
+{
+    const quint32 cols = static_cast<quint32>(columns_);
+    const quint32 first = colsDone_ > cols ? colsDone_ - cols : 0;
+
+    for (Channel& c : ch_) {
+        for (int x = 0; x < columns_; ++x) {
+            const quint32 key = mode_ == DisplayMode::Scroll
+                              ? colsDone_ - cols + static_cast<quint32>(x)
+                              : static_cast<quint32>(x);
+            clearColumn(c.image, x, key);
+        }
+        for (quint32 col = first; col < colsDone_; ++col)
+            renderColumn(c, col);
+    }
+    if (mode_ == DisplayMode::Sweep && colsDone_ > 0 && !archive_)
+        eraseAhead(colsDone_ - 1);
+
+    colsRendered_ = colsDone_;
+}
+
+// Draw the columns finished since the last tick and return the widget
+// area that changed.
+QRect EgramWidget::renderNewColumns()
+{
+    const quint32 n = colsDone_ - colsRendered_;
+    const QRect plot = plotRect(Atrial).united(plotRect(Ventricular));
+
+    // The partial column is drawn live in paintEvent, just right of the
+    // image in scroll mode and at the next slot in sweep mode.
+    const int partialX = mode_ == DisplayMode::Scroll
+                       ? plot.left() + columns_
+                       : plot.left() + static_cast<int>(colsDone_ % static_cast<quint32>(columns_));
+    QRect dirty(partialX, 0, 1, height());
+
+    if (n == 0)
+        return dirty;
+
+    if (n >= static_cast<quint32>(columns_)) {
+        renderAll();
+        return plot.united(dirty);
+    }
+
+    if (mode_ == DisplayMode::Scroll) {
+        // Everything visibly moves, but it is one memmove per scanline
+        // plus n new columns instead of redrawing the whole trace.
+        scrollImages(static_cast<int>(n));
+        for (Channel& c : ch_)
+            for (quint32 col = colsRendered_; col < colsDone_; ++col)
+                renderColumn(c, col);
+        colsRendered_ = colsDone_;
+        return plot.united(dirty);
+    }
+
+    for (Channel& c : ch_)
+        for (quint32 col = colsRendered_; col < colsDone_; ++col)
+            renderColumn(c, col);
+    eraseAhead(colsDone_ - 1);
+
+    const int from = columnX(colsRendered_);
+    const int to = from + static_cast<int>(n) + ERASE_BAR;
+    colsRendered_ = colsDone_;
+
+    if (to >= columns_)                      // wrapped past the right edge
+        return plot.united(dirty);
+    return QRect(plot.left() + from, 0, to - from + 1, height()).united(dirty);
+}
+
+// -------------------------------------------------------------
+// Painting
+// -------------------------------------------------------------
+void EgramWidget::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    if (archive_)
+        showArchiveAt(archiveStartMs_);
+    else
+        rebuildColumns();
+}
+
+void EgramWidget::paintEvent(QPaintEvent* event)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QPainter p(this);
+    const QRect r = event->rect();
+    const QRect plot = plotRect(Atrial).united(plotRect(Ventricular));
+
+    // Margins outside the images.
+    p.fillRect(QRect(0, 0, plot.left(), height()).intersected(r), Qt::white);
+    p.fillRect(QRect(plot.right() + 1, 0, width() - plot.right() - 1, height()).intersected(r), Qt::white);
+
+    // Blit only the exposed part of each image.
+    for (int i = 0; i < ChannelCount; ++i) {
+        const QRect target = plotRect(i).intersected(r);
+        if (!target.isEmpty())
+            p.drawImage(target, ch_[i].image, target.translated(-plotRect(i).topLeft()));
+    }
+
+    // Column still filling, stretched to meet the newest finished one.
+    const int partialX = mode_ == DisplayMode::Scroll
+                       ? plot.left() + columns_
+                       : plot.left() + static_cast<int>(colsDone_ % static_cast<quint32>(columns_));
+    for (int i = 0; i < ChannelCount; ++i) {
+        const Channel& c = ch_[i];
+        if (c.curMin > c.curMax)
+            continue;
+
+        float lo = c.curMin;
+        float hi = c.curMax;
+        if (colsDone_ > 0) {
+            const quint32 prev = (colsDone_ - 1) % static_cast<quint32>(columns_);
+            if (c.colMin[prev] <= c.colMax[prev]) {
+                lo = qMin(lo, c.colMax[prev]);
+                hi = qMax(hi, c.colMin[prev]);
+            }
+        }
+
+        const QRect pr = plotRect(i);
+        const double mid = pr.top() + pr.height() / 2.0;
+        const double scale = (pr.height() / 2.0 - 2.0) / rangeMv_;
+        p.setPen(QPen(QColor(c.color), 1));
+        p.drawLine(QLineF(partialX, mid - hi * scale, partialX, mid - lo * scale));
+    }
+
+    drawMarkers(p);
+
+    lastPaintUs_ = timer.nsecsElapsed() / 1000;
+    avgPaintUs_ = 0.9 * avgPaintUs_ + 0.1 * static_cast<double>(lastPaintUs_);
+}
+
+// Overlay: a tick and label at the top of the channel each marker belongs
+// to, for the markers still inside the visible window.
+void EgramWidget::drawMarkers(QPainter& p)
+{
+    const quint32 cols = static_cast<quint32>(columns_);
+    const quint32 spc = static_cast<quint32>(samplesPerColumn_);
+    const quint32 firstCol = colsDone_ > cols ? colsDone_ - cols : 0;
+    const int left = plotRect(Atrial).left();
+    const quint32 kept = qMin<quint32>(markerCount_, MARKERS);
+
+    for (quint32 k = markerCount_ - kept; k != markerCount_; ++k) {
+        const PlacedMarker& m = markers_[k & (MARKERS - 1)];
+        const quint32 col = m.sample / spc;
+        if (col < firstCol || col > colsDone_)
+            continue;
+
+        int x;
+        if (col == colsDone_)
+            x = mode_ == DisplayMode::Scroll ? left + columns_
+                                             : left + static_cast<int>(colsDone_ % cols);
+        else
+            x = left + columnX(col);
+
+        const bool atrial = m.kind == EgramMarker::AtrialSense || m.kind == EgramMarker::AtrialPace;
+        const bool paced  = m.kind == EgramMarker::AtrialPace || m.kind == EgramMarker::VentricularPace;
+        const QRect r = plotRect(atrial ? Atrial : Ventricular);
+
+        p.setPen(QPen(paced ? QColor(0, 150, 0) : QColor(40, 40, 40), 1));
+        p.drawLine(x, r.top() + 2, x, r.top() + 12);
+        p.drawText(x + 2, r.top() + 12,
+                   QString(atrial ? "A" : "V") + (paced ? "P" : "S"));
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <QImage>
+#include <QWidget>
+
+#include <array>
+#include <vector>
+
+#include "egramdetector.h"   // EgramMarker
+#include "spscqueue.h"
+
+class EgramArchive;
+class EgramBuffer;
+class EgramSpectrogram;
+class QTimer;
+
+// Real-time atrial/ventricular strip chart.
+//
+// Samples are drained from the link's SPSC queue on each tick. Each sample
+// is folded into a running min/max for the pixel column it falls in, and
+// a finished column is drawn once, straight into a per-channel backing
+// image. A tick therefore costs O(new columns), and a paint is a blit of
+// the dirty part of those images.
+//
+// Scroll mode shifts the image left and appends at the right edge; Sweep
+// mode writes in place like a bedside monitor, with an erase bar ahead of
+// the newest column, so only a few columns are repainted per tick.
+//
+// There is no free-running timer. dataAvailable() wakes the widget; it
+// then ticks once per display refresh (or slower, to stay inside the CPU
+// budget) for as long as samples keep arriving, and goes idle when they
+// stop or the widget is hidden or minimized.
+//
+// With an archive set, the widget shows a recording instead: each
+// showArchiveAt() decodes one window through EgramArchive and draws it
+// with the same column machinery, and the live queue is left untouched.
+// Once a column spans SUMMARY_BLOCK samples or more, columns are filled
+// from the archive's min/max pyramid rather than raw samples, so any zoom
+// level costs about one summary per column. The wheel zooms about the
+// cursor while browsing.
+class EgramWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    enum class DisplayMode { Scroll, Sweep };
+
+    explicit EgramWidget(QWidget* parent = nullptr);
+
+    // Queue to drain; owned by PacemakerLink. This widget is its only consumer.
+    void setSource(EgramBuffer* queue) { source_ = queue; }
+
+    // Detector markers, drawn over the trace at the sample they refer to.
+    void setMarkerSource(SpscQueue<EgramMarker>* queue) { markerSource_ = queue; }
+
+    // Also feed every drained live sample to spectrogram (nullptr to stop).
+    void setSpectrogram(EgramSpectrogram* spectrogram) { spectrogram_ = spectrogram; }
+
+    // Browse a recording instead of the live stream; nullptr goes back to
+    // live. The archive must outlive its use here.
+    void setArchive(const EgramArchive* archive);
+    const EgramArchive* archive() const { return archive_; }
+
+    // Show the window that starts at startMs (archive timestamps).
+    void showArchiveAt(quint32 startMs);
+    quint32 archiveStart() const { return archiveStartMs_; }
+
+    // Horizontal scale. The window is capped at what the history holds.
+    void setSampleRate(int hz);
+    void setTimeWindow(double seconds);
+    double timeWindow() const { return windowSec_; }
+
+    // Vertical scale: mV from baseline to the edge of each trace.
+    void setRange(float mv);
+
+    void setDisplayMode(DisplayMode mode);
+    DisplayMode displayMode() const { return mode_; }
+
+    // Paint cost, microseconds: last paintEvent and a running average.
+    qint64 lastPaintUs() const { return lastPaintUs_; }
+    double averagePaintUs() const { return avgPaintUs_; }
+
+    // Share of one core (0..1] the widget may spend draining and drawing.
+    // The frame rate drops below the display refresh to stay within it.
+    void setCpuBudget(double fraction);
+    double cpuBudget() const { return cpuBudget_; }
+    double frameRate() const;           // current target, frames per second
+
+    // Tick again as soon as the event loop is free while samples keep
+    // arriving, ignoring refresh rate and budget. For replay benchmarks.
+    void setUnthrottled(bool on) { unthrottled_ = on; }
+    double averageTickUs() const { return avgTickUs_; }
+
+    void clear();
+
+signals:
+    // The archive view was zoomed from the widget itself.
+    void archiveViewChanged(quint32 startMs, double windowSec);
+
+public slots:
+    // Producer wake-up (PacemakerLink::egramDataAvailable).
+    void dataAvailable();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+
+private:
+    enum { Atrial, Ventricular, ChannelCount };
+
+    struct Channel {
+        std::vector<float> history;   // raw samples, ring of HISTORY
+        std::vector<float> colMin;    // finished columns, ring of columns_
+        std::vector<float> colMax;
+        float  curMin;                // column being filled
+        float  curMax;
+        QImage image;                 // columns_ x channel height, finished columns only
+        QRgb   color;
+    };
+
+    void tick();
+    bool canRender() const;
+    void scheduleFrame();
+    int  frameIntervalMs() const;
+    void drainSource();
+    bool drainMarkers();
+    bool placeMarker(const EgramMarker& m);
+    void appendSamples(const quint32* timeMs, const float* atrial, const float* ventricular, int n);
+    void drawMarkers(QPainter& p);
+    void closeColumn();
+    void rebuildColumns();
+    void resetColumns();
+    void showArchiveSummary(quint32 startMs, quint32 spanMs);
+
+    // Backing images
+    QRect plotRect(int channel) const;
+    int   columnX(quint32 col) const;          // image x of finished column col
+    void  renderAll();
+    QRect renderNewColumns();
+    void  renderColumn(Channel& c, quint32 col);
+    void  scrollImages(int n);
+    void  eraseAhead(quint32 col);
+
+    static constexpr int HISTORY   = 1 << 15;  // samples per channel (32 s at 1 kHz)
+    static constexpr int MARGIN    = 10;
+    static constexpr int ERASE_BAR = 8;        // sweep mode gap, pixels
+    static constexpr int MARKERS   = 256;      // placed markers kept, power of two
+
+    // A marker pinned to the free-running sample index it fired on.
+    struct PlacedMarker {
+        quint32           sample;
+        EgramMarker::Kind kind;
+    };
+
+    QTimer*      frameTimer_{nullptr};   // single shot, armed only while data flows
+    EgramBuffer* source_{nullptr};
+    SpscQueue<EgramMarker>* markerSource_{nullptr};
+    EgramSpectrogram*       spectrogram_{nullptr};
+    const EgramArchive*     archive_{nullptr};
+    quint32                 archiveStartMs_{0};
+
+    int         sampleRate_{1000};
+    double      windowSec_{10.0};
+    float       rangeMv_{5.0f};
+    DisplayMode mode_{DisplayMode::Scroll};
+
+    std::array<Channel, ChannelCount> ch_;
+    std::vector<quint32> timeHistory_;   // device timestamps, ring of HISTORY
+    quint32 written_{0};          // samples received, free-running
+
+    std::array<PlacedMarker, MARKERS> markers_{};
+    quint32     markerCount_{0};  // free-running
+    EgramMarker pendingMarker_;   // popped before its sample was drained
+    bool        hasPendingMarker_{false};
+
+    // Column geometry, recomputed on resize / scale change.
+    int     samplesPerColumn_{1};
+    int     columns_{0};
+    quint32 colsDone_{0};         // finished columns, free-running
+    quint32 colsRendered_{0};     // finished columns already in the images
+    int     inColumn_{0};         // samples in the column being filled
+
+    qint64 lastPaintUs_{0};
+    double avgPaintUs_{0.0};
+    double avgTickUs_{0.0};
+    double cpuBudget_{0.05};
+    bool   unthrottled_{false};
+};
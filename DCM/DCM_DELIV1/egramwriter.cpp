@@ -0,0 +1,143 @@
+#include "egramwriter.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace EgramFile;
+
+EgramWriter::EgramWriter()
+    : m_encoded(static_cast<size_t>(maxChunkBytes(CHUNK_SAMPLES, MAX_CHUNK_MARKERS)))
+{
+}
+
+EgramWriter::~EgramWriter()
+{
+    if (isOpen())
+        finish();
+}
+
+bool EgramWriter::open(const QString& path, int sampleRateHz, qint64 startEpochMs, QString* err)
+{
+    if (isOpen())
+        finish();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (err) *err = m_file.errorString();
+        return false;
+    }
+
+    m_error.clear();
+    m_failed = false;
+    m_written = 0;
+    m_markersWritten = 0;
+    m_markersDropped = 0;
+    m_bytes = 0;
+    m_count = 0;
+    m_markerCount = 0;
+    m_index.clear();
+
+    FileHeader h;
+    h.sampleRateHz = static_cast<quint32>(sampleRateHz);
+    h.startEpochMs = startEpochMs;
+
+    quint8 header[HEADER_SIZE];
+    writeHeader(h, header);
+    if (!writeBytes(header, HEADER_SIZE)) {
+        if (err) *err = m_error;
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool EgramWriter::append(const quint32* timeMs, const float* atrial, const float* ventricular, int n)
+{
+    while (n > 0 && !m_failed) {
+        if (m_count == CHUNK_SAMPLES && !writeChunk())
+            break;
+
+        const int take = qMin(n, CHUNK_SAMPLES - m_count);
+        std::memcpy(m_time.data() + m_count, timeMs, sizeof(quint32) * static_cast<size_t>(take));
+        std::memcpy(m_atrial.data() + m_count, atrial, sizeof(float) * static_cast<size_t>(take));
+        std::memcpy(m_ventricular.data() + m_count, ventricular, sizeof(float) * static_cast<size_t>(take));
+        m_count += take;
+        timeMs += take;
+        atrial += take;
+        ventricular += take;
+        n -= take;
+    }
+    return !m_failed;
+}
+
+bool EgramWriter::appendMarker(const EgramMarker& marker)
+{
+    if (m_markerCount == MAX_CHUNK_MARKERS) {
+        ++m_markersDropped;
+        return false;
+    }
+    m_chunkMarkers[static_cast<size_t>(m_markerCount++)] = marker;
+    return true;
+}
+
+bool EgramWriter::finish(QString* err)
+{
+    if (!isOpen())
+        return !m_failed;
+
+    if (m_count > 0)
+        writeChunk();
+
+    if (!m_failed) {
+        const quint64 indexOffset = static_cast<quint64>(m_file.pos());
+        quint8 buf[INDEX_ENTRY_SIZE];
+        for (const IndexEntry& e : std::as_const(m_index)) {
+            writeIndexEntry(e, buf);
+            if (!writeBytes(buf, INDEX_ENTRY_SIZE))
+                break;
+        }
+
+        quint8 trailer[TRAILER_SIZE];
+        writeTrailer(indexOffset, static_cast<quint32>(m_index.size()), trailer);
+        if (!m_failed)
+            writeBytes(trailer, TRAILER_SIZE);
+    }
+
+    m_file.close();
+    if (m_failed && err)
+        *err = m_error;
+    return !m_failed;
+}
+
+bool EgramWriter::writeChunk()
+{
+    IndexEntry e;
+    e.offset = static_cast<quint64>(m_file.pos());
+    const int bytes = encodeChunk(m_time.data(), m_atrial.data(), m_ventricular.data(), m_count,
+                                  m_chunkMarkers.data(), m_markerCount, m_encoded.data(),
+                                  &e.summary);
+
+    const bool ok = writeBytes(m_encoded.data(), bytes);
+    if (ok) {
+        m_index.append(e);
+        m_written += static_cast<quint64>(m_count);
+        m_markersWritten += static_cast<quint64>(m_markerCount);
+        // Bound what a crash can lose to one chunk.
+        m_file.flush();
+    }
+
+    m_count = 0;
+    m_markerCount = 0;
+    return ok;
+}
+
+bool EgramWriter::writeBytes(const quint8* data, qint64 len)
+{
+    if (m_file.write(reinterpret_cast<const char*>(data), len) != len) {
+        m_failed = true;
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_bytes += static_cast<quint64>(len);
+    return true;
+}
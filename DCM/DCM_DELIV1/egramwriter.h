@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <array>
+#include <vector>
+
+#include "egramdetector.h"
+#include "egramfile.h"
+
+// Destination for a stream of egram samples and markers, written on the
+// calling thread. EgramRecorder drives one from its writer thread; the
+// format is chosen when the recording starts.
+class EgramSink {
+public:
+    virtual ~EgramSink() = default;
+
+    virtual bool open(const QString& path, int sampleRateHz, qint64 startEpochMs,
+                      QString* err = nullptr) = 0;
+    virtual bool isOpen() const = 0;
+
+    // False once a write has failed; errorString() says why.
+    virtual bool append(const quint32* timeMs, const float* atrial, const float* ventricular, int n) = 0;
+    virtual bool appendMarker(const EgramMarker& marker) = 0;
+
+    // Writes whatever is buffered and closes the file.
+    virtual bool finish(QString* err = nullptr) = 0;
+    virtual QString errorString() const = 0;
+
+    virtual quint64 samplesWritten() const = 0;
+    virtual quint64 markersWritten() const = 0;
+    virtual quint64 markersDropped() const = 0;
+    virtual quint64 chunksWritten() const = 0;     // format's unit of storage
+    virtual quint64 bytesWritten() const = 0;
+};
+
+// Writes an .egr file (see egramfile.h) on the calling thread.
+//
+// Samples and markers are collected into one chunk; the chunk is encoded
+// and appended when the next sample would overflow it, so a marker that
+// follows its sample still lands in the same chunk. finish() writes the
+// last partial chunk, the index and the trailer. Memory is fixed at one
+// chunk plus one IndexEntry per chunk, whatever the length of the file.
+// EgramRecorder runs one on its writer thread; importers and captures use
+// one directly.
+class EgramWriter : public EgramSink {
+public:
+    EgramWriter();
+    ~EgramWriter() override;
+
+    // Truncates path and writes the header.
+    bool open(const QString& path, int sampleRateHz, qint64 startEpochMs, QString* err = nullptr) override;
+    bool isOpen() const override { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+
+    bool append(const quint32* timeMs, const float* atrial, const float* ventricular, int n) override;
+
+    // Goes with the chunk being filled. False (and counted) if that chunk
+    // already holds MAX_CHUNK_MARKERS.
+    bool appendMarker(const EgramMarker& marker) override;
+
+    // Flushes the partial chunk, writes the index and trailer, and closes.
+    bool finish(QString* err = nullptr) override;
+
+    QString errorString() const override { return m_error; }
+
+    quint64 samplesWritten() const override { return m_written; }
+    quint64 markersWritten() const override { return m_markersWritten; }
+    quint64 markersDropped() const override { return m_markersDropped; }
+    quint64 chunksWritten() const override { return static_cast<quint64>(m_index.size()); }
+    quint64 bytesWritten() const override { return m_bytes; }
+
+private:
+    bool writeChunk();
+    bool writeBytes(const quint8* data, qint64 len);
+
+    QFile   m_file;
+    QString m_error;
+    bool    m_failed{false};
+
+    quint64 m_written{0};
+    quint64 m_markersWritten{0};
+    quint64 m_markersDropped{0};
+    quint64 m_bytes{0};
+
+    // Chunk being assembled
+    std::array<quint32, EgramFile::CHUNK_SAMPLES> m_time{};
+    std::array<float, EgramFile::CHUNK_SAMPLES>   m_atrial{};
+    std::array<float, EgramFile::CHUNK_SAMPLES>   m_ventricular{};
+    int                                           m_count{0};
+    std::array<EgramMarker, EgramFile::MAX_CHUNK_MARKERS> m_chunkMarkers{};
+    int                                           m_markerCount{0};
+
+    std::vector<quint8>              m_encoded;
+    QVector<EgramFile::IndexEntry>   m_index;
+};
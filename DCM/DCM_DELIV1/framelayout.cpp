@@ -0,0 +1,79 @@
+#include "framelayout.h"
+
+namespace FrameLayout {
+
+// -------------------------------------------------------------
+// Parameter frame codec
+// -------------------------------------------------------------
+void encodeParameters(const Database::ModeProfile& p, quint8* f)
+{
+    put<Mode>(f, modeToCode(p.mode));
+    put<Lrl>(f, static_cast<quint8>(p.lrl.value_or(0)));
+    put<Url>(f, static_cast<quint8>(p.url.value_or(0)));
+
+    put<AAmp>(f, static_cast<float>(p.aAmp.value_or(0.0)));
+    put<VAmp>(f, static_cast<float>(p.vAmp.value_or(0.0)));
+    put<APw>(f,  static_cast<float>(p.aPw.value_or(0.0)));
+    put<VPw>(f,  static_cast<float>(p.vPw.value_or(0.0)));
+
+    put<Vrp>(f, static_cast<quint16>(p.vrp.value_or(0)));
+    put<Arp>(f, static_cast<quint16>(p.arp.value_or(0)));
+
+    put<HysteresisTime>(f, 0);
+    put<Avd>(f, 0);
+    put<ReactionTime>(f, 0);
+}
+
+Database::ModeProfile decodeParameters(const quint8* f)
+{
+    Database::ModeProfile p;
+    p.userId = -1;
+
+    p.mode = codeToMode(get<Mode>(f));
+    p.lrl  = get<Lrl>(f);
+    p.url  = get<Url>(f);
+
+    p.aAmp = get<AAmp>(f);
+    p.vAmp = get<VAmp>(f);
+    p.aPw  = get<APw>(f);
+    p.vPw  = get<VPw>(f);
+
+    p.vrp = get<Vrp>(f);
+    p.arp = get<Arp>(f);
+
+    return p;
+}
+
+// -------------------------------------------------------------
+// Mode mapping
+// -------------------------------------------------------------
+quint8 modeToCode(const QString& mode)
+{
+    const QString m = mode.toUpper();
+    if (m == "AOO")  return 1;
+    if (m == "VOO")  return 2;
+    if (m == "AAI")  return 3;
+    if (m == "VVI")  return 4;
+    if (m == "AOOR") return 5;
+    if (m == "VOOR") return 6;
+    if (m == "AAIR") return 7;
+    if (m == "VVIR") return 8;
+    return 0xFF;
+}
+
+QString codeToMode(quint8 code)
+{
+    switch (code) {
+    case 1: return "AOO";
+    case 2: return "VOO";
+    case 3: return "AAI";
+    case 4: return "VVI";
+    case 5: return "AOOR";
+    case 6: return "VOOR";
+    case 7: return "AAIR";
+    case 8: return "VVIR";
+    default: return "AOO";
+    }
+}
+
+} // namespace FrameLayout
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#include "database.h"  // Database::ModeProfile
+
+// Single source of truth for the 32-byte serial frame.
+//
+// Every field of each frame type is described once in a FIELDS table
+// below; get<>/put<> are instantiated per field, so offsets and widths
+// are compile-time constants and the generated code is a straight
+// sequence of loads/stores. Overlapping or out-of-range fields fail the build.
+namespace FrameLayout {
+
+constexpr int FRAME_SIZE = 32;
+using FrameBytes = std::array<quint8, FRAME_SIZE>;
+
+// Message types (byte 0, where the firmware reads its command)
+constexpr quint8 MSG_SET_PARAMS      = 0x01;
+constexpr quint8 MSG_REQUEST_PARAMS  = 0x02;
+constexpr quint8 MSG_PARAMS_RESPONSE = 0x03;
+constexpr quint8 MSG_EGRAM_SAMPLES   = 0x04;
+constexpr quint8 MSG_EGRAM_START     = 0x07;
+constexpr quint8 MSG_EGRAM_STOP      = 0x08;
+constexpr quint8 MSG_HELLO           = 0x09;
+constexpr quint8 MSG_HELLO_ACK       = 0x0A;
+constexpr quint8 MSG_EGRAM_PACKED    = 0x0B;
+
+// Capability handshake
+constexpr quint8  PROTOCOL_VERSION = 1;
+constexpr quint16 CAP_PACKED_EGRAM = 0x0001;
+constexpr quint16 CAP_PARAM_ECHO   = 0x0002;   // answers a tracked SET_PARAMS with its stored values
+
+// Marker placed in the Sync field when SyncCrc framing is enabled.
+constexpr quint8 SYNC_BYTE = 0xA5;
+
+// -------------------------------------------------------------
+// Field descriptors
+// -------------------------------------------------------------
+enum class Kind { U8, U16, I16, U32, F32 };
+
+struct FieldDesc {
+    int  offset;
+    Kind kind;
+    int  count = 1;   // > 1 for a fixed array of kind
+};
+
+constexpr int widthOf(Kind k)
+{
+    return k == Kind::U8 ? 1 : ((k == Kind::U16 || k == Kind::I16) ? 2 : 4);
+}
+
+template <std::size_t N>
+constexpr bool fieldsFit(const std::array<FieldDesc, N>& table)
+{
+    for (const FieldDesc& d : table)
+        if (d.offset < 0 || d.offset + widthOf(d.kind) * d.count > FRAME_SIZE)
+            return false;
+    return true;
+}
+
+template <std::size_t N>
+constexpr bool fieldsDisjoint(const std::array<FieldDesc, N>& table)
+{
+    for (std::size_t i = 0; i < N; ++i)
+        for (std::size_t j = i + 1; j < N; ++j) {
+            const int aEnd = table[i].offset + widthOf(table[i].kind) * table[i].count;
+            const int bEnd = table[j].offset + widthOf(table[j].kind) * table[j].count;
+            if (table[i].offset < bEnd && table[j].offset < aEnd)
+                return false;
+        }
+    return true;
+}
+
+// -------------------------------------------------------------
+// Typed little-endian access at a compile-time offset
+// -------------------------------------------------------------
+template <Kind K> struct KindType;
+template <> struct KindType<Kind::U8>  { using type = quint8;  };
+template <> struct KindType<Kind::U16> { using type = quint16; };
+template <> struct KindType<Kind::I16> { using type = qint16;  };
+template <> struct KindType<Kind::U32> { using type = quint32; };
+template <> struct KindType<Kind::F32> { using type = float;   };
+
+template <int Offset, Kind K>
+inline void putAt(quint8* frame, typename KindType<K>::type v)
+{
+    quint8* p = frame + Offset;
+
+    if constexpr (K == Kind::U8) {
+        p[0] = v;
+    } else if constexpr (K == Kind::U16 || K == Kind::I16) {
+        const quint16 raw = static_cast<quint16>(v);
+        p[0] = static_cast<quint8>(raw);
+        p[1] = static_cast<quint8>(raw >> 8);
+    } else {
+        quint32 raw;
+        std::memcpy(&raw, &v, sizeof(raw));
+        p[0] = static_cast<quint8>(raw);
+        p[1] = static_cast<quint8>(raw >> 8);
+        p[2] = static_cast<quint8>(raw >> 16);
+        p[3] = static_cast<quint8>(raw >> 24);
+    }
+}
+
+template <int Offset, Kind K>
+inline typename KindType<K>::type getAt(const quint8* frame)
+{
+    const quint8* p = frame + Offset;
+
+    if constexpr (K == Kind::U8) {
+        return p[0];
+    } else if constexpr (K == Kind::U16 || K == Kind::I16) {
+        return static_cast<typename KindType<K>::type>(static_cast<quint16>(p[0] | (p[1] << 8)));
+    } else {
+        const quint32 raw = quint32(p[0]) | (quint32(p[1]) << 8)
+                          | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+        typename KindType<K>::type v;
+        std::memcpy(&v, &raw, sizeof(v));
+        return v;
+    }
+}
+
+// -------------------------------------------------------------
+// Parameter frame (MSG_SET_PARAMS / MSG_REQUEST_PARAMS / MSG_PARAMS_RESPONSE)
+// -------------------------------------------------------------
+enum Field : int {
+    Type,            // message type
+    Sync,            // SyncCrc marker (0 in Raw framing; the firmware requires it)
+    Mode,            // pacing mode code, see modeToCode()
+    Lrl,             // ppm
+    Url,             // ppm
+    AAmp,            // V
+    VAmp,            // V
+    APw,             // ms
+    VPw,             // ms
+    Vrp,             // ms
+    Arp,             // ms
+    HysteresisTime,  // not programmed by the DCM; sent as 0
+    Avd,             // not programmed by the DCM; sent as 0
+    ReactionTime,    // not programmed by the DCM; sent as 0
+    Crc,             // SyncCrc framing only, see CRC_OFFSET
+    Seq,             // request sequence number, echoed in replies (0 = untracked)
+    FieldCount
+};
+
+// Sensitivity has no slot: the firmware reads every byte from 2 to 30.
+constexpr std::array<FieldDesc, FieldCount> FIELDS = {{
+    {  0, Kind::U8  },  // Type
+    {  1, Kind::U8  },  // Sync
+    {  2, Kind::U8  },  // Mode
+    {  3, Kind::U8  },  // Lrl
+    {  4, Kind::U8  },  // Url
+    {  5, Kind::F32 },  // AAmp
+    {  9, Kind::F32 },  // VAmp
+    { 13, Kind::F32 },  // APw
+    { 17, Kind::F32 },  // VPw
+    { 21, Kind::U16 },  // Vrp
+    { 23, Kind::U16 },  // Arp
+    { 25, Kind::U8  },  // HysteresisTime
+    { 26, Kind::U16 },  // Avd
+    { 28, Kind::U8  },  // ReactionTime
+    { 29, Kind::U16 },  // Crc
+    { 31, Kind::U8  },  // Seq
+}};
+
+static_assert(fieldsFit(FIELDS), "frame field extends past FRAME_SIZE");
+static_assert(fieldsDisjoint(FIELDS), "frame fields overlap");
+
+// Where the pacemaker's serial receive chart (Simulink, rxdata(k) is
+// byte k-1 here) reads each parameter. The DCM side must agree.
+namespace Firmware {
+constexpr int COMMAND         = 0;   // 1 = set parameters
+constexpr int RESERVED        = 1;   // frame dropped unless 0
+constexpr int MODE            = 2;
+constexpr int LRL             = 3;
+constexpr int URL             = 4;   // read as MSR
+constexpr int A_AMP           = 5;
+constexpr int V_AMP           = 9;
+constexpr int A_PW            = 13;
+constexpr int V_PW            = 17;
+constexpr int VRP             = 21;
+constexpr int ARP             = 23;
+constexpr int HYSTERESIS_TIME = 25;
+constexpr int AVD             = 26;
+constexpr int REACTION_TIME   = 28;
+constexpr int RESPONSE_FACTOR = 29;
+constexpr int RECOVERY_TIME   = 30;
+} // namespace Firmware
+
+static_assert(FIELDS[Type].offset == Firmware::COMMAND && FIELDS[Sync].offset == Firmware::RESERVED,
+              "message type must be the firmware's command byte");
+static_assert(FIELDS[Mode].offset == Firmware::MODE
+              && FIELDS[Lrl].offset == Firmware::LRL
+              && FIELDS[Url].offset == Firmware::URL
+              && FIELDS[AAmp].offset == Firmware::A_AMP
+              && FIELDS[VAmp].offset == Firmware::V_AMP
+              && FIELDS[APw].offset == Firmware::A_PW
+              && FIELDS[VPw].offset == Firmware::V_PW
+              && FIELDS[Vrp].offset == Firmware::VRP
+              && FIELDS[Arp].offset == Firmware::ARP
+              && FIELDS[HysteresisTime].offset == Firmware::HYSTERESIS_TIME
+              && FIELDS[Avd].offset == Firmware::AVD
+              && FIELDS[ReactionTime].offset == Firmware::REACTION_TIME,
+              "parameter field disagrees with the firmware byte map");
+static_assert(FIELDS[Seq].offset > Firmware::RECOVERY_TIME,
+              "Seq must sit in a byte the firmware does not read");
+
+// The CRC covers every byte of the frame but its own two. In Raw framing
+// those bytes are the firmware's ResponseFactor and RecoveryTime, sent as
+// 0; SyncCrc framing needs firmware that checks the CRC there instead.
+constexpr int CRC_OFFSET = FIELDS[Crc].offset;
+constexpr int SYNC_OFFSET = FIELDS[Sync].offset;
+constexpr int CRC_END    = CRC_OFFSET + widthOf(FIELDS[Crc].kind);
+static_assert(CRC_OFFSET == Firmware::RESPONSE_FACTOR && CRC_END == Firmware::RECOVERY_TIME + 1,
+              "CRC must replace exactly the fields the DCM does not program");
+
+// -------------------------------------------------------------
+// Egram sample frame (MSG_EGRAM_SAMPLES): one sample pair per frame
+// -------------------------------------------------------------
+namespace Egram {
+
+enum Field : int {
+    Type,
+    Sync,
+    Time,         // device timestamp, ms
+    Atrial,       // mV
+    Ventricular,  // mV
+    Crc,
+    FieldCount
+};
+
+constexpr std::array<FieldDesc, FieldCount> FIELDS = {{
+    {  0, Kind::U8  },  // Type
+    {  1, Kind::U8  },  // Sync
+    {  2, Kind::U32 },  // Time
+    {  6, Kind::F32 },  // Atrial
+    { 10, Kind::F32 },  // Ventricular
+    { 29, Kind::U16 },  // Crc
+}};
+
+static_assert(fieldsFit(FIELDS), "egram field extends past FRAME_SIZE");
+static_assert(fieldsDisjoint(FIELDS), "egram fields overlap");
+
+} // namespace Egram
+
+// -------------------------------------------------------------
+// Packed egram frame (MSG_EGRAM_PACKED): up to PAIRS_PER_FRAME
+// int16 atrial/ventricular pairs, only sent once negotiated
+// -------------------------------------------------------------
+namespace EgramPacked {
+
+enum Field : int {
+    Type,
+    Sync,
+    Counter,      // index of the first sample, wraps at 2^16
+    Count,        // valid pairs in this frame
+    Samples,      // interleaved atrial, ventricular; microvolts
+    Crc,
+    FieldCount
+};
+
+constexpr int PAIRS_PER_FRAME = 6;
+
+constexpr std::array<FieldDesc, FieldCount> FIELDS = {{
+    {  0, Kind::U8  },                       // Type
+    {  1, Kind::U8  },                       // Sync
+    {  2, Kind::U16 },                       // Counter
+    {  4, Kind::U8  },                       // Count
+    {  5, Kind::I16, 2 * PAIRS_PER_FRAME },  // Samples
+    { 29, Kind::U16 },                       // Crc
+}};
+
+static_assert(fieldsFit(FIELDS), "packed egram field extends past FRAME_SIZE");
+static_assert(fieldsDisjoint(FIELDS), "packed egram fields overlap");
+
+// Sample i of the interleaved array (even = atrial, odd = ventricular).
+inline qint16 sample(const quint8* frame, int i)
+{
+    return getAt<0, Kind::I16>(frame + FIELDS[Samples].offset + 2 * i);
+}
+
+inline void setSample(quint8* frame, int i, qint16 v)
+{
+    putAt<0, Kind::I16>(frame + FIELDS[Samples].offset + 2 * i, v);
+}
+
+// Wire units to mV.
+constexpr float MV_PER_LSB = 0.001f;
+
+} // namespace EgramPacked
+
+// -------------------------------------------------------------
+// Capability handshake (MSG_HELLO / MSG_HELLO_ACK)
+// -------------------------------------------------------------
+namespace Hello {
+
+enum Field : int {
+    Type,
+    Sync,
+    Version,      // PROTOCOL_VERSION of the sender
+    Caps,         // CAP_* bits the sender supports
+    EgramRateHz,  // ACK only: device egram sample rate
+    Crc,
+    Seq,          // same position as the parameter frame's Seq
+    FieldCount
+};
+
+constexpr std::array<FieldDesc, FieldCount> FIELDS = {{
+    {  0, Kind::U8  },  // Type
+    {  1, Kind::U8  },  // Sync
+    {  2, Kind::U8  },  // Version
+    {  3, Kind::U16 },  // Caps
+    {  5, Kind::U16 },  // EgramRateHz
+    { 29, Kind::U16 },  // Crc
+    { 31, Kind::U8  },  // Seq
+}};
+
+static_assert(fieldsFit(FIELDS), "hello field extends past FRAME_SIZE");
+static_assert(fieldsDisjoint(FIELDS), "hello fields overlap");
+
+} // namespace Hello
+
+// Type, Sync, sequence number and CRC must sit at the same place in every
+// frame type, since dispatch, request tracking and framing read them
+// before knowing the type.
+static_assert(Egram::FIELDS[Egram::Type].offset == FIELDS[Type].offset
+              && EgramPacked::FIELDS[EgramPacked::Type].offset == FIELDS[Type].offset
+              && Hello::FIELDS[Hello::Type].offset == FIELDS[Type].offset,
+              "Type must sit at the same offset in every frame");
+static_assert(Egram::FIELDS[Egram::Sync].offset == SYNC_OFFSET
+              && EgramPacked::FIELDS[EgramPacked::Sync].offset == SYNC_OFFSET
+              && Hello::FIELDS[Hello::Sync].offset == SYNC_OFFSET,
+              "Sync must sit at the same offset in every frame");
+static_assert(Egram::FIELDS[Egram::Crc].offset == CRC_OFFSET
+              && EgramPacked::FIELDS[EgramPacked::Crc].offset == CRC_OFFSET
+              && Hello::FIELDS[Hello::Crc].offset == CRC_OFFSET,
+              "CRC must sit at the same offset in every frame");
+static_assert(Hello::FIELDS[Hello::Seq].offset == FIELDS[Seq].offset,
+              "Seq must sit at the same offset in every request/reply frame");
+
+// -------------------------------------------------------------
+// get<>/put<> for any field of any table above
+// -------------------------------------------------------------
+template <typename E> struct LayoutOf;
+template <> struct LayoutOf<Field>              { static constexpr const auto& fields = FIELDS; };
+template <> struct LayoutOf<Egram::Field>       { static constexpr const auto& fields = Egram::FIELDS; };
+template <> struct LayoutOf<EgramPacked::Field> { static constexpr const auto& fields = EgramPacked::FIELDS; };
+template <> struct LayoutOf<Hello::Field>       { static constexpr const auto& fields = Hello::FIELDS; };
+
+template <auto F>
+constexpr FieldDesc descOf = LayoutOf<decltype(F)>::fields[F];
+
+template <auto F>
+using FieldType = typename KindType<descOf<F>.kind>::type;
+
+template <auto F>
+inline void put(quint8* frame, FieldType<F> v)
+{
+    putAt<descOf<F>.offset, descOf<F>.kind>(frame, v);
+}
+
+template <auto F>
+inline FieldType<F> get(const quint8* frame)
+{
+    return getAt<descOf<F>.offset, descOf<F>.kind>(frame);
+}
+
+// -------------------------------------------------------------
+// Frame value type
+// -------------------------------------------------------------
+
+// One wire frame, held by value. Builders return it, the TX path writes
+// straight from it, so the protocol hot path never allocates.
+struct Frame {
+    FrameBytes bytes{};
+
+    quint8*       data()       { return bytes.data(); }
+    const quint8* data() const { return bytes.data(); }
+    const char*   constData() const { return reinterpret_cast<const char*>(bytes.data()); }
+
+    quint8 type() const { return get<Type>(bytes.data()); }
+};
+
+static_assert(sizeof(Frame) == FRAME_SIZE, "Frame must be exactly one wire frame");
+static_assert(std::is_trivially_copyable<Frame>::value, "Frame must be trivially copyable");
+
+// -------------------------------------------------------------
+// Parameter frame codec
+// -------------------------------------------------------------
+
+// Fills Mode..ReactionTime; leaves Type, Sync, Seq and Crc to the caller.
+// Sensitivities are not sent (no firmware slot).
+void encodeParameters(const Database::ModeProfile& p, quint8* frame);
+
+// Decodes Mode..Arp. userId is set to -1 and aSens/vSens are left unset
+// (not carried on the wire).
+Database::ModeProfile decodeParameters(const quint8* frame);
+
+// Pacing mode <-> wire code (1..8; 0xFF for unknown).
+quint8  modeToCode(const QString& mode);
+QString codeToMode(quint8 code);
+
+} // namespace FrameLayout
@@ -0,0 +1,136 @@
+#include "linkscheduler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using FrameLayout::FRAME_SIZE;
+
+namespace {
+// Bulk may burst this many frames after an idle period.
+constexpr int BULK_BURST_FRAMES = 4;
+}
+
+// -------------------------------------------------------------
+// Construction / configuration
+// -------------------------------------------------------------
+LinkScheduler::LinkScheduler(int framesPerClass)
+{
+    for (Queue& q : m_queues) {
+        q.frames.resize(static_cast<size_t>(framesPerClass));
+        q.stamps.resize(static_cast<size_t>(framesPerClass));
+    }
+
+    // Unshaped until setBulkShare() is called.
+    setBulkShare(1.0, 0);
+}
+
+void LinkScheduler::setBulkShare(double share, qint64 linkBytesPerSec)
+{
+    share = qBound(0.01, share, 1.0);
+
+    // Unknown link rate: do not shape at all.
+    m_bytesPerUs = linkBytesPerSec > 0 ? share * linkBytesPerSec / 1e6 : 0.0;
+    m_burst = BULK_BURST_FRAMES * FRAME_SIZE;
+    m_tokens = m_burst;
+}
+
+// -------------------------------------------------------------
+// Queueing
+// -------------------------------------------------------------
+bool LinkScheduler::enqueue(Priority prio, const FrameLayout::Frame& frame, qint64 nowUs)
+{
+    Queue& q = m_queues[prio];
+    const int cap = static_cast<int>(q.frames.size());
+
+    if (q.count == cap) {
+        ++q.stats.rejected;
+        return false;
+    }
+
+    const int slot = (q.head + q.count) % cap;
+    q.frames[slot] = frame;
+    q.stamps[slot] = nowUs;
+    ++q.count;
+    q.stats.depth = q.count;
+    return true;
+}
+
+int LinkScheduler::dequeue(quint8* dst, int maxBytes, qint64 nowUs)
+{
+    refillTokens(nowUs);
+
+    int out = 0;
+    for (int p = 0; p < PriorityCount; ++p) {
+        Queue& q = m_queues[p];
+        const int cap = static_cast<int>(q.frames.size());
+
+        while (q.count > 0 && out + FRAME_SIZE <= maxBytes) {
+            if (p == Bulk && m_bytesPerUs > 0.0) {
+                if (m_tokens < FRAME_SIZE)
+                    break;
+                m_tokens -= FRAME_SIZE;
+            }
+
+            std::memcpy(dst + out, q.frames[q.head].data(), FRAME_SIZE);
+            out += FRAME_SIZE;
+
+            const qint64 latency = nowUs - q.stamps[q.head];
+            q.stats.totalLatencyUs += latency;
+            q.stats.maxLatencyUs = qMax(q.stats.maxLatencyUs, latency);
+            ++q.stats.frames;
+            q.stats.bytes += FRAME_SIZE;
+
+            q.head = (q.head + 1) % cap;
+            --q.count;
+        }
+        q.stats.depth = q.count;
+    }
+
+    return out;
+}
+
+qint64 LinkScheduler::bulkDelayUs(qint64 nowUs)
+{
+    if (m_queues[Bulk].count == 0)
+        return -1;
+    if (m_bytesPerUs <= 0.0)
+        return 0;
+
+    refillTokens(nowUs);
+    if (m_tokens >= FRAME_SIZE)
+        return 0;
+    return static_cast<qint64>((FRAME_SIZE - m_tokens) / m_bytesPerUs) + 1;
+}
+
+void LinkScheduler::refillTokens(qint64 nowUs)
+{
+    if (m_bytesPerUs > 0.0)
+        m_tokens = std::min(m_burst, m_tokens + (nowUs - m_lastRefillUs) * m_bytesPerUs);
+    m_lastRefillUs = nowUs;
+}
+
+bool LinkScheduler::isEmpty() const
+{
+    for (const Queue& q : m_queues)
+        if (q.count > 0)
+            return false;
+    return true;
+}
+
+void LinkScheduler::clear()
+{
+    for (Queue& q : m_queues) {
+        q.head = 0;
+        q.count = 0;
+        q.stats.depth = 0;
+    }
+    m_tokens = m_burst;
+}
+
+void LinkScheduler::resetStats()
+{
+    for (Queue& q : m_queues) {
+        q.stats = ClassStats{};
+        q.stats.depth = q.count;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <vector>
+
+#include "framelayout.h"
+
+// Outbound frame scheduler for PacemakerLink.
+//
+// Three bounded queues, drained strictly by priority: control frames
+// (parameter writes/reads) always leave first, telemetry next, and bulk
+// traffic last. Bulk is additionally rate-shaped by a token bucket so it
+// can never take more than a configured share of the link bandwidth.
+// Not thread-safe; PacemakerLink drives it from its I/O thread.
+class LinkScheduler {
+public:
+    enum Priority { Control, Telemetry, Bulk, PriorityCount };
+
+    struct ClassStats {
+        int     depth{0};          // frames waiting
+        quint64 frames{0};         // frames handed to the port
+        quint64 bytes{0};
+        quint64 rejected{0};       // refused because the class queue was full
+        qint64  totalLatencyUs{0}; // enqueue -> handed to the port
+        qint64  maxLatencyUs{0};
+    };
+
+    explicit LinkScheduler(int framesPerClass);
+
+    // Queue one frame; false if that class is full.
+    bool enqueue(Priority prio, const FrameLayout::Frame& frame, qint64 nowUs);
+
+    // Copy up to maxBytes of whole frames into dst in priority order.
+    // Returns the number of bytes written to dst.
+    int dequeue(quint8* dst, int maxBytes, qint64 nowUs);
+
+    // Bulk may use at most share (0..1] of linkBytesPerSec.
+    void setBulkShare(double share, qint64 linkBytesPerSec);
+
+    // Microseconds until a waiting bulk frame has enough tokens, 0 if it
+    // can go now, -1 if no bulk frame is waiting.
+    qint64 bulkDelayUs(qint64 nowUs);
+
+    bool isEmpty() const;
+    void clear();
+
+    const ClassStats& stats(Priority prio) const { return m_queues[prio].stats; }
+    void resetStats();
+
+private:
+    struct Queue {
+        std::vector<FrameLayout::Frame> frames;
+        std::vector<qint64>             stamps;   // enqueue time per slot
+        int head{0};
+        int count{0};
+        ClassStats stats;
+    };
+
+    void refillTokens(qint64 nowUs);
+
+    std::array<Queue, PriorityCount> m_queues;
+
+    // Bulk token bucket, in bytes.
+    double m_bytesPerUs{0.0};
+    double m_tokens{0.0};
+    double m_burst{0.0};
+    qint64 m_lastRefillUs{0};
+};
@@ -2,14 +2,27 @@
 #include "ui_mainwindow.h"
 
 #include "database.h"
+#include "egramarchive.h"
+#include "egramedf.h"
+#include "egramrecorder.h"
+#include "egramspectrogram.h"
+#include "egramstats.h"
+#include "egramtrigger.h"
+#include "egramwidget.h"
+#include "pacemakerlink.h"
 #include "parameterform.h"
-#include "serialmanager.h"
 #include "serialtestdialog.h"
 
+#include <QComboBox>
 #include <QDesktopServices>
+#include <QDialog>
+#include <QDir>
+#include <QDoubleSpinBox>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QUrl>
 #include <QPushButton>
+#include <QCheckBox>
 #include <QVBoxLayout>
 #include <QMenuBar>
 #include <QAction>
@@ -19,60 +32,23 @@
 #include <QFileDialog>
 #include <QFile>
 #include <QTextStream>
-#include <QTimer>
-#include <QPainter>
-#include <QPainterPath>
 #include <QStatusBar>
 #include <QLabel>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QSplitter>
 
-// ------------------------------------------------------------------
-// Simple dummy Egram widget (visual only, no real signal yet).
-// ------------------------------------------------------------------
-class EgramWidget : public QWidget {
-    Q_OBJECT
-public:
-    explicit EgramWidget(QWidget* parent = nullptr)
-        : QWidget(parent)
-    {
-        setMinimumHeight(200);
-        timer_ = new QTimer(this);
-        connect(timer_, &QTimer::timeout, this, [this]() {
-            phase_ += 0.15;
-            if (phase_ > 10000.0)
-                phase_ = 0.0;
-            update();
-        });
-        timer_->start(30);
-    }
-
-protected:
-    void paintEvent(QPaintEvent*) override {
-        QPainter p(this);
-        p.fillRect(rect(), Qt::white);
-        p.setRenderHint(QPainter::Antialiasing, true);
-
-        // Baseline
-        p.setPen(QPen(Qt::gray, 1, Qt::DashLine));
-        p.drawLine(10, height() / 2, width() - 10, height() / 2);
-
-        // Fake waveform
-        p.setPen(QPen(Qt::blue, 2));
-        QPainterPath path;
-        path.moveTo(10, height() / 2);
-        for (int x = 0; x < width() - 20; ++x) {
-            double t = (phase_ + x) / 20.0;
-            double v = std::sin(t) * 30.0 + std::sin(t * 0.23) * 5.0;
-            path.lineTo(10 + x, height() / 2 - v);
-        }
-        p.drawPath(path);
-    }
-
-private:
-    QTimer* timer_{nullptr};
-    double  phase_{0.0};
-};
-
-#include "mainwindow.moc"
+namespace {
+// "< 60", "60-64", ..., ">= 120" for histogram bin i.
+QString rateBinLabel(const EgramStats& s, int i)
+{
+    if (i == 0)
+        return QString("< %1").arg(s.binLowerBpm(1));
+    if (i == s.binCount() - 1)
+        return QString(">= %1").arg(s.binLowerBpm(i));
+    return QString("%1-%2").arg(s.binLowerBpm(i)).arg(s.binLowerBpm(i + 1) - 1);
+}
+}
 
 // ------------------------------------------------------------------
 // MainWindow
@@ -106,16 +82,88 @@ MainWindow::MainWindow(int userId, const QString& username, QWidget* parent)
 
     // Egram page
     if (auto* eLayout = ui->egramPage->findChild<QVBoxLayout*>("egramLayout")) {
-        egram_ = new EgramWidget(this);
-        eLayout->insertWidget(0, egram_);
+        // Waveform with the spectrogram beside it (spectrumChk).
+        auto* split = new QSplitter(Qt::Horizontal, this);
+        egram_ = new EgramWidget(split);
+        spectrogram_ = new EgramSpectrogram(split);
+        spectrogram_->hide();
+        split->addWidget(egram_);
+        split->addWidget(spectrogram_);
+        split->setStretchFactor(0, 3);
+        split->setStretchFactor(1, 1);
+        eLayout->insertWidget(0, split);
+        egram_->setSpectrogram(spectrogram_);
+        connect(ui->spectrumChk, &QCheckBox::toggled, spectrogram_, [this](bool on) {
+            spectrogram_->clear();
+            spectrogram_->setVisible(on);
+        });
+
+        // Shown only while browsing a recording.
+        archiveBar_ = new QScrollBar(Qt::Horizontal, this);
+        archiveBar_->hide();
+        eLayout->insertWidget(1, archiveBar_);
+        connect(archiveBar_, &QScrollBar::valueChanged, this, [this](int ms) {
+            if (archive_)
+                egram_->showArchiveAt(archive_->firstTimeMs() + static_cast<quint32>(ms));
+        });
+        connect(egram_, &EgramWidget::archiveViewChanged, this, &MainWindow::syncArchiveBar);
     }
 
     // Open DB folder button on About tab
     connect(ui->openDbFolderBtn, &QPushButton::clicked,
             this, &MainWindow::onOpenDbFolder);
 
-    // Serial manager
-    serial_ = new SerialManager(this);
+    // Pacemaker link (port I/O runs on its own thread)
+    link_ = new PacemakerLink(this);
+    form_->setLink(link_);
+    connect(link_, &PacemakerLink::errorOccurred,
+            this, &MainWindow::onLinkError);
+    connect(link_, &PacemakerLink::replayFinished,
+            this, &MainWindow::onReplayFinished);
+    connect(link_, &PacemakerLink::egramTriggered,
+            this, &MainWindow::onEgramTriggered);
+    connect(link_, &PacemakerLink::capabilitiesNegotiated,
+            this, &MainWindow::syncSampleRate);
+    // The link keeps the statistics; each wake-up carries a fresh copy.
+    connect(link_, &PacemakerLink::egramDataAvailable,
+            this, &MainWindow::syncStats);
+    if (egram_) {
+        egram_->setSource(link_->egramQueue());
+        egram_->setMarkerSource(link_->markerQueue());
+        connect(link_, &PacemakerLink::egramDataAvailable,
+                egram_, &EgramWidget::dataAvailable);
+    }
+
+    // Egram filter selection (checkboxes in mainwindow.ui)
+    auto applyFilters = [this]() {
+        quint32 presets = 0;
+        if (ui->baselineChk->isChecked()) presets |= EgramDsp::BaselineRemoval;
+        if (ui->bandPassChk->isChecked()) presets |= EgramDsp::BandPass;
+        if (ui->notchChk->isChecked())    presets |= EgramDsp::Notch60;
+        link_->setEgramFilters(presets);
+    };
+    connect(ui->baselineChk, &QCheckBox::toggled, this, applyFilters);
+    connect(ui->bandPassChk, &QCheckBox::toggled, this, applyFilters);
+    connect(ui->notchChk,    &QCheckBox::toggled, this, applyFilters);
+
+    // Triggered capture (triggerCombo order matches EgramTrigger::Source).
+    auto applyTrigger = [this]() {
+        EgramTrigger::Config config;
+        config.source  = static_cast<EgramTrigger::Source>(ui->triggerCombo->currentIndex());
+        config.levelMv = static_cast<float>(ui->triggerLevelSpin->value());
+        link_->setTrigger(config);
+        ui->triggerLevelSpin->setEnabled(config.source == EgramTrigger::Source::Threshold);
+    };
+    connect(ui->triggerCombo, &QComboBox::currentIndexChanged, this, applyTrigger);
+    connect(ui->triggerLevelSpin, &QDoubleSpinBox::valueChanged, this, applyTrigger);
+    ui->triggerLevelSpin->setEnabled(false);
+
+    // Egram recording (recordBtn). A write error ends the recording.
+    recorder_ = new EgramRecorder(this);
+    connect(recorder_, &EgramRecorder::errorOccurred, this, [this](const QString& msg) {
+        ui->recordBtn->setChecked(false);
+        QMessageBox::warning(this, "Record", msg);
+    });
 
     // Build File / Help menus (Tools menu is from .ui)
     buildMenus();
@@ -123,6 +171,11 @@ MainWindow::MainWindow(int userId, const QString& username, QWidget* parent)
 
 MainWindow::~MainWindow()
 {
+    // Detach before the recorder (a child) is destroyed.
+    link_->setRecorder(nullptr);
+    if (egram_)
+        egram_->setArchive(nullptr);
+    delete archive_;
     delete ui;
 }
 
@@ -139,12 +192,25 @@ void MainWindow::buildMenus()
     auto actBrady = fileMenu->addAction("Export Bradycardia Parameters (HTML)...");
     auto actTemp  = fileMenu->addAction("Export Temporary Parameters (HTML)...");
     fileMenu->addSeparator();
+    auto actOpenEg = fileMenu->addAction("Open Egram Recording...");
+    auto actLiveEg = fileMenu->addAction("Live Egram");
+    auto actReplay = fileMenu->addAction("Replay Egram Recording...");
+    auto actStopRp = fileMenu->addAction("Stop Replay");
+    auto actExpEdf = fileMenu->addAction("Export Egram Recording as EDF+...");
+    auto actImpEdf = fileMenu->addAction("Import EDF...");
+    fileMenu->addSeparator();
     auto actQuit  = fileMenu->addAction("Quit");
 
     connect(actNew,   &QAction::triggered, this, &MainWindow::onNewPatient);
     connect(actClock, &QAction::triggered, this, &MainWindow::onSetClock);
     connect(actBrady, &QAction::triggered, this, &MainWindow::onExportBradyParams);
     connect(actTemp,  &QAction::triggered, this, &MainWindow::onExportTemporaryParams);
+    connect(actOpenEg, &QAction::triggered, this, &MainWindow::onOpenEgramRecording);
+    connect(actLiveEg, &QAction::triggered, this, &MainWindow::onLiveEgram);
+    connect(actReplay, &QAction::triggered, this, &MainWindow::onReplayEgramRecording);
+    connect(actStopRp, &QAction::triggered, link_, &PacemakerLink::stopReplay);
+    connect(actExpEdf, &QAction::triggered, this, &MainWindow::onExportEgramEdf);
+    connect(actImpEdf, &QAction::triggered, this, &MainWindow::onImportEdf);
     connect(actQuit,  &QAction::triggered, this, &MainWindow::onQuit);
 
     // Help
@@ -178,7 +244,45 @@ QString MainWindow::buildReportHtml(const QString& reportName) const
         html += QString("<tr><td>%1</td><td>%2</td></tr>")
         .arg(it.key(), it.value());
     }
-    html += "</table></body></html>";
+    html += "</table>";
+
+    // Egram statistics since the parameters were last sent (or the replay began).
+    const EgramStats s = link_->egramStats();
+    if (s.atrial().total() > 0 || s.ventricular().total() > 0) {
+        const auto chamberRow = [](const QString& name, const EgramStats::Chamber& c) {
+            return QString("<tr><td>%1</td><td>%2</td><td>%3</td><td>%4%</td></tr>")
+                .arg(name).arg(c.sensed).arg(c.paced)
+                .arg(c.pacedPercent(), 0, 'f', 1);
+        };
+
+        html += "<h2>Egram Statistics</h2>";
+        html += "<table><tr><th>Chamber</th><th>Sensed</th><th>Paced</th><th>Paced %</th></tr>";
+        html += chamberRow("Atrium", s.atrial());
+        html += chamberRow("Ventricle", s.ventricular());
+        html += "</table>";
+
+        if (s.intervals() > 0) {
+            html += QString("<p>Ventricular rate over %1 intervals: last %2 bpm, average %3 bpm, "
+                            "mean %4 bpm, range %5-%6 bpm</p>")
+                        .arg(s.intervals())
+                        .arg(qRound(s.instantaneousBpm()))
+                        .arg(qRound(s.averageBpm()))
+                        .arg(qRound(s.meanBpm()))
+                        .arg(qRound(s.minBpm()))
+                        .arg(qRound(s.maxBpm()));
+
+            html += "<table><tr><th>Rate (bpm)</th><th>Intervals</th><th>%</th></tr>";
+            for (int i = 0; i < s.binCount(); ++i) {
+                html += QString("<tr><td>%1</td><td>%2</td><td>%3</td></tr>")
+                    .arg(rateBinLabel(s, i).toHtmlEscaped())
+                    .arg(s.binAt(i))
+                    .arg(100.0 * s.binAt(i) / s.intervals(), 0, 'f', 1);
+            }
+            html += "</table>";
+        }
+    }
+
+    html += "</body></html>";
     return html;
 }
 
@@ -256,6 +360,249 @@ void MainWindow::onExportTemporaryParams()
     statusBar()->showMessage("Temporary report exported.", 3000);
 }
 
+void MainWindow::onOpenEgramRecording()
+{
+    if (!egram_)
+        return;
+
+    const QString in = QFileDialog::getOpenFileName(
+        this, "Open Egram Recording", QString(), "Egram Recordings (*.egr)");
+    if (!in.isEmpty())
+        openArchive(in);
+}
+
+// Shows the recording at path in the egram view, in place of live data.
+bool MainWindow::openArchive(const QString& path)
+{
+    auto* archive = new EgramArchive;
+    QString err;
+    if (!archive->open(path, &err)) {
+        delete archive;
+        QMessageBox::warning(this, "Open Egram Recording", "Cannot open recording: " + err);
+        return false;
+    }
+
+    egram_->setArchive(archive);
+    delete archive_;
+    archive_ = archive;
+
+    syncArchiveBar();
+    archiveBar_->show();
+    ui->tabs->setCurrentWidget(ui->egramPage);
+
+    statusBar()->showMessage(QString("Browsing %1 (%2 s)")
+                                 .arg(QFileInfo(path).fileName())
+                                 .arg((archive_->lastTimeMs() - archive_->firstTimeMs()) / 1000), 5000);
+    return true;
+}
+
+// The recording being browsed, or one picked here.
+void MainWindow::onExportEgramEdf()
+{
+    EgramArchive picked;
+    const EgramArchive* archive = archive_;
+    if (!archive) {
+        const QString in = QFileDialog::getOpenFileName(
+            this, "Export Egram Recording", QString(), "Egram Recordings (*.egr)");
+        if (in.isEmpty())
+            return;
+        QString err;
+        if (!picked.open(in, &err)) {
+            QMessageBox::warning(this, "Export EDF+", "Cannot open recording: " + err);
+            return;
+        }
+        archive = &picked;
+    }
+
+    const QFileInfo src(archive->path());
+    const QString out = QFileDialog::getSaveFileName(
+        this, "Export EDF+", src.absolutePath() + "/" + src.completeBaseName() + ".edf",
+        "EDF+ (*.edf)");
+    if (out.isEmpty())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    QString err;
+    if (!EgramEdf::exportRecording(*archive, out, &err)) {
+        QMessageBox::warning(this, "Export EDF+", "Export failed: " + err);
+        return;
+    }
+    statusBar()->showMessage(QString("Exported %1 samples to %2 in %3 s")
+                                 .arg(archive->sampleCount())
+                                 .arg(QFileInfo(out).fileName())
+                                 .arg(timer.elapsed() / 1000.0, 0, 'f', 1), 5000);
+}
+
+// Converts to .egr, which the viewer and replay both read.
+void MainWindow::onImportEdf()
+{
+    if (!egram_)
+        return;
+
+    const QString in = QFileDialog::getOpenFileName(this, "Import EDF", QString(), "EDF / EDF+ (*.edf)");
+    if (in.isEmpty())
+        return;
+
+    const QFileInfo src(in);
+    const QString out = QFileDialog::getSaveFileName(
+        this, "Save Imported Recording", src.absolutePath() + "/" + src.completeBaseName() + ".egr",
+        "Egram Recordings (*.egr)");
+    if (out.isEmpty())
+        return;
+
+    // The view may be holding the file about to be overwritten.
+    if (archive_ && QFileInfo(archive_->path()) == QFileInfo(out))
+        onLiveEgram();
+
+    QString err;
+    if (!EgramEdf::importFile(in, out, &err)) {
+        QMessageBox::warning(this, "Import EDF", "Import failed: " + err);
+        return;
+    }
+    openArchive(out);
+}
+
+// Scroll bar range and page follow the egram's current archive window.
+void MainWindow::syncArchiveBar()
+{
+    if (!archive_)
+        return;
+
+    const int spanMs = static_cast<int>(archive_->lastTimeMs() - archive_->firstTimeMs());
+    const int pageMs = static_cast<int>(egram_->timeWindow() * 1000.0);
+
+    const QSignalBlocker block(archiveBar_);
+    archiveBar_->setRange(0, qMax(0, spanMs - pageMs));
+    archiveBar_->setPageStep(pageMs);
+    archiveBar_->setSingleStep(qMax(1, pageMs / 10));
+    archiveBar_->setValue(static_cast<int>(egram_->archiveStart() - archive_->firstTimeMs()));
+}
+
+// Live views follow the stream rate settled by HELLO or a replay.
+void MainWindow::syncSampleRate()
+{
+    if (!egram_)
+        return;
+    const int rate = link_->egramSampleRate();
+    if (!archive_)
+        egram_->setSampleRate(rate);
+    spectrogram_->setSampleRate(rate);
+}
+
+// Heart rate, pacing split on the egram toolbar and the rate histogram in
+// its tooltip, from the link's latest copy of the statistics.
+void MainWindow::syncStats()
+{
+    const EgramStats s = link_->egramStats();
+    ui->hrLabel->setText(s.intervals() > 0
+                             ? QString("HR: %1 bpm").arg(qRound(s.averageBpm()))
+                             : QString("HR: -- bpm"));
+
+    const auto percent = [](const EgramStats::Chamber& c) {
+        return c.total() ? QString::number(qRound(c.pacedPercent())) : QString("--");
+    };
+    QString text = QString("Paced A: %1% V: %2%").arg(percent(s.atrial()), percent(s.ventricular()));
+    if (s.intervals() > 0)
+        text += QString("  Avg: %1 bpm").arg(qRound(s.averageBpm()));
+    ui->statsLabel->setText(text);
+
+    QString tip = QString("Rate %1 bpm (last beat), %2 average, %3 mean, %4-%5 range\n")
+                      .arg(qRound(s.instantaneousBpm()))
+                      .arg(qRound(s.averageBpm()))
+                      .arg(qRound(s.meanBpm()))
+                      .arg(qRound(s.minBpm()))
+                      .arg(qRound(s.maxBpm()));
+    for (int i = 0; i < s.binCount(); ++i)
+        tip += QString("\n%1: %2").arg(rateBinLabel(s, i)).arg(s.binAt(i));
+    ui->statsLabel->setToolTip(tip);
+}
+
+void MainWindow::onLiveEgram()
+{
+    if (!egram_ || !archive_)
+        return;
+
+    egram_->setArchive(nullptr);
+    delete archive_;
+    archive_ = nullptr;
+    archiveBar_->hide();
+    syncSampleRate();
+    statusBar()->showMessage("Showing live egram.", 3000);
+}
+
+void MainWindow::onReplayEgramRecording()
+{
+    if (!egram_)
+        return;
+
+    const QString in = QFileDialog::getOpenFileName(
+        this, "Replay Egram Recording", QString(), "Egram Recordings (*.egr)");
+    if (in.isEmpty())
+        return;
+
+    const QStringList speeds{ "1x", "2x", "10x", "Flat-out (benchmark)" };
+    bool picked = false;
+    const QString speed = QInputDialog::getItem(this, "Replay Egram Recording", "Speed:",
+                                                speeds, 0, false, &picked);
+    if (!picked)
+        return;
+
+    const int choice = speeds.indexOf(speed);
+    replayFlatOut_ = choice == 3;
+    const double factor = replayFlatOut_ ? 0.0 : speed.chopped(1).toDouble();
+
+    onLiveEgram();
+    egram_->clear();
+    spectrogram_->clear();
+    egram_->setUnthrottled(replayFlatOut_);
+    link_->resetStats();
+
+    QString err;
+    if (!link_->startReplay(in, factor, &err)) {
+        egram_->setUnthrottled(false);
+        QMessageBox::warning(this, "Replay", "Cannot replay: " + err);
+        return;
+    }
+    syncStats();                      // cleared by the replay starting
+    syncSampleRate();
+    ui->tabs->setCurrentWidget(ui->egramPage);
+    statusBar()->showMessage("Replaying " + QFileInfo(in).fileName() + " (" + speed + ")", 3000);
+}
+
+void MainWindow::onReplayFinished(quint64 samples, qint64 elapsedUs)
+{
+    egram_->setUnthrottled(false);
+
+    const double seconds = qMax<qint64>(1, elapsedUs) / 1e6;
+    if (!replayFlatOut_) {
+        statusBar()->showMessage(QString("Replay finished: %1 samples in %2 s.")
+                                     .arg(samples).arg(seconds, 0, 'f', 1), 5000);
+        return;
+    }
+
+    // Flat-out: while the view drains the queue nothing is dropped, so this
+    // is the rate the filters, detector and renderer sustain together. If
+    // the view was hidden the link ran on without it and dropped samples.
+    const PacemakerLink::LinkStats st = link_->stats();
+    const double dspSeconds = qMax<quint64>(1, st.egramProcessNs) / 1e9;
+    const QString dropped = st.egramDropped == 0 ? QString()
+        : QString("\n\n%1 samples were not displayed (egram view hidden), "
+                  "so the pipeline rate does not include the view.").arg(st.egramDropped);
+    QMessageBox::information(this, "Replay Benchmark",
+        QString("%1 samples in %2 s\n\n"
+                "Pipeline (filters + detector + egram view): %3 samples/s\n"
+                "Filters + detector alone: %4 samples/s\n"
+                "Egram view: %5 µs per tick, %6 µs per paint (average)%7")
+            .arg(samples)
+            .arg(seconds, 0, 'f', 2)
+            .arg(samples / seconds, 0, 'f', 0)
+            .arg(samples / dspSeconds, 0, 'f', 0)
+            .arg(egram_->averageTickUs(), 0, 'f', 0)
+            .arg(egram_->averagePaintUs(), 0, 'f', 0)
+            .arg(dropped));
+}
+
 void MainWindow::onQuit()
 {
     close();
@@ -303,7 +650,7 @@ void MainWindow::on_actionSerialTest_triggered()
 // SERIAL COMMUNICATION: SEND PARAMETERS
 // ------------------------------------------------------------------
 
-// Start button: build parameter frame and send over serial
+// Start button: validate parameters and hand them to the link
 void MainWindow::on_startBtn_clicked()
 {
     if (!form_) {
@@ -311,16 +658,17 @@ void MainWindow::on_startBtn_clicked()
         return;
     }
 
-    QByteArray frame;
+    Database::ModeProfile profile;
     QString err;
-    if (!form_->buildTxFrame(&frame, &err)) {
+    if (!form_->tryBuildProfile(&profile, &err)) {
         QMessageBox::warning(this, "Invalid Parameters", err);
         return;
     }
+    link_->setDetectorProfile(profile);   // also clears and rebins the statistics
 
-    // Ensure serial is open; if not, ask for a port
-    if (!serial_->isOpen()) {
-        QStringList ports = serial_->availablePorts();
+    // Ensure the link is open; if not, ask for a port
+    if (!link_->isConnected()) {
+        QStringList ports = link_->availablePorts();
         if (ports.isEmpty()) {
             QMessageBox::warning(this, "Serial", "No serial ports available.");
             return;
@@ -332,28 +680,158 @@ void MainWindow::on_startBtn_clicked()
         if (!ok || port.isEmpty())
             return;
 
+        // Whether the device can confirm what it stored is known once the
+        // HELLO exchange settles (at most a few hundred ms). Connected
+        // before the port opens so a fast answer cannot be missed.
+        const QMetaObject::Connection programOnHello =
+            connect(link_, &PacemakerLink::capabilitiesNegotiated, this,
+                    [this, profile]() { programDevice(profile); },
+                    Qt::SingleShotConnection);
+
         QString serr;
-        if (!serial_->openPort(port, 115200, &serr)) {
+        if (!link_->connectToDevice(port, 115200, &serr)) {
+            disconnect(programOnHello);
             QMessageBox::warning(this, "Serial",
                                  "Failed to open " + port + ": " + serr);
             return;
         }
+
+        ui->paramStatus->setText("Connecting to device...");
+        return;
     }
 
-    if (!serial_->writeBytes(frame)) {
-        QMessageBox::warning(this, "Serial", "Failed to write to serial port.");
+    programDevice(profile);
+}
+
+void MainWindow::programDevice(const Database::ModeProfile& profile)
+{
+    // Firmware without CAP_PARAM_ECHO never answers a SET_PARAMS, so a
+    // verified write would always time out: just send it.
+    if (!(link_->capabilities() & FrameLayout::CAP_PARAM_ECHO)) {
+        link_->sendParameters(profile);
+        ui->paramStatus->setText("Parameters sent (this device does not confirm them).");
+        statusBar()->showMessage("Parameters sent to device.", 3000);
         return;
     }
 
-    ui->paramStatus->setText("Frame sent to pacemaker.");
-    statusBar()->showMessage("Parameters sent to device.", 3000);
+    // Write + echo check in one round trip; the result comes back from
+    // the link's I/O thread and is handled here on the GUI thread.
+    ui->paramStatus->setText("Programming device...");
+    link_->programAndVerify(profile).then(this, [this](const PacemakerLink::ProgramResult& r) {
+        if (!r.error.isEmpty()) {
+            ui->paramStatus->setText("Programming failed: " + r.error);
+            return;
+        }
+
+        if (!r.ok) {
+            ui->paramStatus->setText("Device readback mismatch.");
+            QMessageBox::warning(this, "Verify Failed",
+                                 "Device did not store the sent values:\n" + r.mismatches.join("\n"));
+            return;
+        }
+
+        ui->paramStatus->setText(QString("Parameters programmed and verified (%1 ms).")
+                                     .arg(r.latencyUs / 1000.0, 0, 'f', 1));
+        statusBar()->showMessage("Parameters sent to device.", 3000);
+    });
 }
 
 // Stop button: just closes the serial port for now
 void MainWindow::on_stopBtn_clicked()
 {
-    if (serial_->isOpen())
-        serial_->closePort();
-
+    link_->disconnectFromDevice();
     statusBar()->showMessage("Serial port closed.", 3000);
 }
+
+void MainWindow::on_recordBtn_toggled(bool on)
+{
+    if (!on) {
+        if (!recorder_->isRecording())
+            return;
+        link_->setRecorder(nullptr);
+        recorder_->stop();
+
+        const EgramRecorder::Stats s = recorder_->stats();
+        statusBar()->showMessage(QString("Recorded %1 samples (%2 KB, %3 dropped) to %4")
+                                     .arg(s.samples).arg(s.bytes / 1024).arg(s.dropped)
+                                     .arg(QFileInfo(recorder_->path()).fileName()), 5000);
+        return;
+    }
+
+    const QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
+    const QString out = QFileDialog::getSaveFileName(
+        this, "Record Egram", QString("egram_%1.egr").arg(stamp),
+        "Egram Recordings (*.egr);;EDF+ (*.edf)");
+
+    QString err;
+    if (out.isEmpty() || !recorder_->start(out, link_->egramSampleRate(), &err)) {
+        if (!err.isEmpty())
+            QMessageBox::warning(this, "Record", "Cannot start recording: " + err);
+        const QSignalBlocker block(ui->recordBtn);
+        ui->recordBtn->setChecked(false);
+        return;
+    }
+
+    link_->setRecorder(recorder_);
+    statusBar()->showMessage("Recording to " + QFileInfo(out).fileName(), 3000);
+}
+
+// Each capture is saved next to the database; the live view keeps running.
+void MainWindow::onEgramTriggered(const EgramCapture& capture)
+{
+    const QDir dir(QFileInfo(Database::path()).absolutePath() + "/captures");
+    if (!dir.exists() && !QDir().mkpath(dir.path())) {
+        statusBar()->showMessage("Capture: cannot create " + dir.path(), 5000);
+        return;
+    }
+
+    const QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz");
+    const QString out = dir.filePath(QString("capture_%1.egr").arg(stamp));
+    QString err;
+    if (!EgramRecorder::writeFile(out, capture.sampleRateHz, capture.timeMs.constData(),
+                                  capture.atrial.constData(), capture.ventricular.constData(),
+                                  capture.timeMs.size(), capture.markers.constData(),
+                                  capture.markers.size(), &err)) {
+        statusBar()->showMessage("Capture: " + err, 5000);
+        return;
+    }
+
+    lastCapture_ = out;
+    ui->captureBtn->setEnabled(true);
+    statusBar()->showMessage(QString("Triggered at %1 ms, saved %2")
+                                 .arg(capture.triggerTimeMs).arg(QFileInfo(out).fileName()), 5000);
+}
+
+// Opens the last capture in its own window, leaving the live view alone.
+void MainWindow::on_captureBtn_clicked()
+{
+    auto* archive = new EgramArchive;
+    QString err;
+    if (!archive->open(lastCapture_, &err)) {
+        delete archive;
+        QMessageBox::warning(this, "Last Capture", "Cannot open capture: " + err);
+        return;
+    }
+
+    auto* dlg = new QDialog(this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->setWindowTitle(QFileInfo(lastCapture_).fileName());
+    dlg->resize(800, 300);
+
+    auto* view = new EgramWidget(dlg);
+    auto* layout = new QVBoxLayout(dlg);
+    layout->addWidget(view);
+
+    view->setSampleRate(archive->sampleRate());
+    view->setTimeWindow(qMax(1.0, (archive->lastTimeMs() - archive->firstTimeMs() + 1) / 1000.0));
+    view->setArchive(archive);
+    view->showArchiveAt(archive->firstTimeMs());
+    connect(view, &QObject::destroyed, this, [archive]() { delete archive; });
+
+    dlg->show();
+}
+
+void MainWindow::onLinkError(const QString& msg)
+{
+    statusBar()->showMessage("Serial: " + msg, 5000);
+}
@@ -3,10 +3,17 @@
 #include <QMainWindow>
 #include <QString>
 
+#include "database.h"   // Database::ModeProfile
+
 class ParameterForm;
+struct EgramCapture;
+class EgramArchive;
+class EgramRecorder;
+class EgramSpectrogram;
 class EgramWidget;
-class SerialManager;
+class PacemakerLink;
 class SerialTestDialog;
+class QScrollBar;
 
 namespace Ui { class MainWindow; }
 
@@ -23,6 +30,11 @@ private slots:
     void onSetClock();
     void onExportBradyParams();
     void onExportTemporaryParams();
+    void onOpenEgramRecording();
+    void onLiveEgram();
+    void onReplayEgramRecording();
+    void onExportEgramEdf();
+    void onImportEdf();
     void onQuit();
 
     // Help menu
@@ -37,6 +49,13 @@ private slots:
     // Egram tab buttons (startBtn / stopBtn in mainwindow.ui)
     void on_startBtn_clicked();   // send parameters to device
     void on_stopBtn_clicked();    // close serial port
+    void on_recordBtn_toggled(bool on);
+    void on_captureBtn_clicked();   // show the last triggered capture
+
+    // PacemakerLink notifications
+    void onLinkError(const QString& msg);
+    void onReplayFinished(quint64 samples, qint64 elapsedUs);
+    void onEgramTriggered(const EgramCapture& capture);
 
 private:
     Ui::MainWindow* ui;
@@ -45,7 +64,13 @@ private:
 
     ParameterForm* form_{nullptr};
     EgramWidget*   egram_{nullptr};
-    SerialManager* serial_{nullptr};
+    EgramSpectrogram* spectrogram_{nullptr};
+    EgramRecorder* recorder_{nullptr};
+    EgramArchive*  archive_{nullptr};    // recording being browsed, if any
+    QScrollBar*    archiveBar_{nullptr}; // position within it, ms from the start
+    bool           replayFlatOut_{false};
+    QString        lastCapture_;         // .egr of the most recent trigger
+    PacemakerLink* link_{nullptr};
 
     QString lastClockSet_;  // most recent "device clock" time
 
@@ -56,5 +81,10 @@ private:
     QString institution() const { return "McMaster University"; }
 
     void buildMenus();
+    bool openArchive(const QString& path);
+    void syncArchiveBar();
+    void syncSampleRate();
+    void syncStats();
+    void programDevice(const Database::ModeProfile& profile);
     QString buildReportHtml(const QString& reportName) const;
 };
@@ -1,21 +1,84 @@
 #include "pacemakerlink.h"
+#include "egramrecorder.h"
+#include "framelayout.h"
+
 #include <QSerialPortInfo>
 #include <QDebug>
+#include <QPromise>
+#include <QTimer>
 #include <QtMath>
 
+#include <array>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+using namespace FrameLayout;
+
 // -------------------------------------------------------------
-// Message definitions for 32-byte protocol
+// Link constants (frame layout lives in framelayout.h)
 // -------------------------------------------------------------
 namespace {
-constexpr int FRAME_SIZE = 32;
+// RX ring size; several hundred frames of slack between readyRead calls.
+constexpr int RX_CAPACITY = 8192;
+
+// TX queue size per priority class, in frames. Frames beyond this are
+// refused, not blocked on.
+constexpr int TX_QUEUE_FRAMES = 64;
+
+// Most frames coalesced into one write. Kept small so a control frame
+// queued behind a bulk batch waits at most this many frame times.
+constexpr int TX_BATCH_FRAMES = 8;
+
+// Default ceiling for bulk traffic, as a fraction of link bandwidth.
+constexpr double DEFAULT_BULK_SHARE = 0.5;
+
+// Decoded egram samples the renderer may fall behind by: 4 s at 1 kHz.
+constexpr int EGRAM_CAPACITY = 4096;
+
+// Detector markers the renderer may fall behind by.
+constexpr int MARKER_CAPACITY = 256;
+
+// Default egram wake-up cadence (25 per second).
+constexpr int DEFAULT_EGRAM_INTERVAL_MS = 40;
 
-constexpr quint8 MSG_SET_PARAMS      = 0x01;
-constexpr quint8 MSG_REQUEST_PARAMS  = 0x02;
-constexpr quint8 MSG_PARAMS_RESPONSE = 0x03;
+// Packed egram frames carry no timestamp; their sample index is converted
+// at the rate the device reports in HELLO_ACK, or this one if it reports 0.
+constexpr int DEFAULT_EGRAM_RATE_HZ = 1000;
 
-constexpr quint8 MSG_EGRAM_SAMPLES   = 0x04; // unused (stubbed)
-constexpr quint8 MSG_EGRAM_START     = 0x07;
-constexpr quint8 MSG_EGRAM_STOP      = 0x08;
+// Capabilities this host implements, and how long to wait for the device
+// to answer HELLO before assuming legacy firmware.
+constexpr quint16 HOST_CAPS = CAP_PACKED_EGRAM | CAP_PARAM_ECHO;
+constexpr int HELLO_TIMEOUT_MS = 250;
+
+// Replay cadence at finite speeds, and the most samples fed per pump
+// (bounds the time spent in one event-loop turn).
+constexpr int REPLAY_TICK_MS = 5;
+constexpr int REPLAY_MAX_PER_PUMP = 16384;
+
+// A flat-out replay whose queue has sat full this long has no renderer
+// draining it (view hidden or minimized); it carries on and drops.
+constexpr qint64 REPLAY_STALL_US = 250000;
+
+// Requests awaiting a reply at any one time.
+constexpr int MAX_IN_FLIGHT = 16;
+
+// SyncCrc framing uses CRC-16/CCITT-FALSE over every byte but the CRC's own
+// (see FrameLayout::CRC_OFFSET).
+constexpr std::array<quint16, 256> makeCrcTable()
+{
+    std::array<quint16, 256> t{};
+    for (int i = 0; i < 256; ++i) {
+        quint16 c = static_cast<quint16>(i << 8);
+        for (int b = 0; b < 8; ++b)
+            c = (c & 0x8000) ? static_cast<quint16>((c << 1) ^ 0x1021)
+                             : static_cast<quint16>(c << 1);
+        t[i] = c;
+    }
+    return t;
+}
+
+constexpr std::array<quint16, 256> CRC_TABLE = makeCrcTable();
 }
 
 // -------------------------------------------------------------
@@ -23,24 +86,84 @@ constexpr quint8 MSG_EGRAM_STOP      = 0x08;
 // -------------------------------------------------------------
 PacemakerLink::PacemakerLink(QObject* parent)
     : QObject(parent)
+    , m_egramRateHz(DEFAULT_EGRAM_RATE_HZ)
+    , m_egram(EGRAM_CAPACITY)
+    , m_markers(MARKER_CAPACITY)
+    , m_rx(RX_CAPACITY)
+    , m_sched(TX_QUEUE_FRAMES)
+    , m_txBatch(TX_BATCH_FRAMES * FRAME_SIZE)
+    , m_bulkShare(DEFAULT_BULK_SHARE)
+    , m_egramIntervalMs(DEFAULT_EGRAM_INTERVAL_MS)
 {
-    connect(&m_port, &QSerialPort::readyRead,
-            this, &PacemakerLink::handleReadyRead);
+    m_thread.setObjectName("PacemakerLink I/O");
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(&m_port, &QSerialPort::errorOccurred,
-            this, &PacemakerLink::handleError);
-#else
-    connect(&m_port,
-            static_cast<void (QSerialPort::*)(QSerialPort::SerialPortError)>(&QSerialPort::error),
-            this, &PacemakerLink::handleError);
-#endif
+    m_io = new QObject;
+    m_io->moveToThread(&m_thread);
+    m_thread.start(QThread::HighPriority);
+
+    // The port must be created on the thread that services it.
+    QMetaObject::invokeMethod(m_io, [this]() { initPort(); },
+                              Qt::BlockingQueuedConnection);
 }
 
 PacemakerLink::~PacemakerLink()
 {
-    if (m_port.isOpen())
-        m_port.close();
+    QMetaObject::invokeMethod(m_io, [this]() {
+        closePort();
+        delete m_port;
+        m_port = nullptr;
+    }, Qt::BlockingQueuedConnection);
+
+    m_thread.quit();
+    m_thread.wait();
+    delete m_io;
+}
+
+void PacemakerLink::post(std::function<void()> fn)
+{
+    QMetaObject::invokeMethod(m_io, std::move(fn), Qt::QueuedConnection);
+}
+
+void PacemakerLink::initPort()
+{
+    m_port = new QSerialPort(m_io);
+
+    m_clock.start();
+    m_deadlineTimer = new QTimer(m_io);
+    m_deadlineTimer->setSingleShot(true);
+    connect(m_deadlineTimer, &QTimer::timeout,
+            m_io, [this]() { expireRequests(); });
+
+    m_bulkTimer = new QTimer(m_io);
+    m_bulkTimer->setSingleShot(true);
+    m_bulkTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_bulkTimer, &QTimer::timeout,
+            m_io, [this]() { pumpTx(); });
+
+    m_egramTimer = new QTimer(m_io);
+    m_egramTimer->setSingleShot(true);
+    connect(m_egramTimer, &QTimer::timeout,
+            m_io, [this]() { notifyEgram(); });
+
+    m_replayTimer = new QTimer(m_io);
+    m_replayTimer->setSingleShot(true);
+    m_replayTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_replayTimer, &QTimer::timeout,
+            m_io, [this]() { pumpReplay(); });
+
+    connect(m_port, &QSerialPort::readyRead,
+            m_io, [this]() { handleReadyRead(); });
+    connect(m_port, &QSerialPort::bytesWritten,
+            m_io, [this](qint64 n) { handleBytesWritten(n); });
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(m_port, &QSerialPort::errorOccurred,
+            m_io, [this](QSerialPort::SerialPortError e) { handleError(e); });
+#else
+    connect(m_port,
+            static_cast<void (QSerialPort::*)(QSerialPort::SerialPortError)>(&QSerialPort::error),
+            m_io, [this](QSerialPort::SerialPortError e) { handleError(e); });
+#endif
 }
 
 // -------------------------------------------------------------
@@ -60,20 +183,21 @@ QStringList PacemakerLink::availablePorts() const
 // -------------------------------------------------------------
 bool PacemakerLink::connectToDevice(const QString& portName, qint32 baudRate, QString* errorMessage)
 {
-    if (m_port.isOpen())
-        m_port.close();
+    bool ok = false;
+    QString err;
+    QMetaObject::invokeMethod(m_io, [&]() {
+        // The device takes over the egram pipeline.
+        if (m_replay)
+            endReplay();
+        ok = openPort(portName, baudRate, &err);
+        if (ok)
+            sendHello();
+    }, Qt::BlockingQueuedConnection);
 
-    m_port.setPortName(portName);
-    m_port.setBaudRate(baudRate);
-    m_port.setDataBits(QSerialPort::Data8);
-    m_port.setParity(QSerialPort::NoParity);
-    m_port.setStopBits(QSerialPort::OneStop);
-    m_port.setFlowControl(QSerialPort::NoFlowControl);
-
-    if (!m_port.open(QIODevice::ReadWrite)) {
+    if (!ok) {
         if (errorMessage)
-            *errorMessage = m_port.errorString();
-        emit errorOccurred(m_port.errorString());
+            *errorMessage = err;
+        emit errorOccurred(err);
         return false;
     }
 
@@ -83,10 +207,82 @@ bool PacemakerLink::connectToDevice(const QString& portName, qint32 baudRate, QS
 
 void PacemakerLink::disconnectFromDevice()
 {
-    if (m_port.isOpen()) {
-        m_port.close();
-        emit disconnected();
+    post([this]() {
+        if (m_port->isOpen()) {
+            closePort();
+            emit disconnected();
+        }
+    });
+}
+
+bool PacemakerLink::openPort(const QString& portName, qint32 baudRate, QString* errorMessage)
+{
+    closePort();
+    m_rx.clear();
+    m_inSync = true;
+
+    m_port->setPortName(portName);
+    m_port->setBaudRate(baudRate);
+    m_port->setDataBits(QSerialPort::Data8);
+    m_port->setParity(QSerialPort::NoParity);
+    m_port->setStopBits(QSerialPort::OneStop);
+    m_port->setFlowControl(QSerialPort::NoFlowControl);
+
+    if (!m_port->open(QIODevice::ReadWrite)) {
+        *errorMessage = m_port->errorString();
+        return false;
     }
+
+    m_sched.setBulkShare(m_bulkShare, baudRate / 10);   // 8N1: 10 bits per byte
+    m_connected = true;
+    return true;
+}
+
+void PacemakerLink::closePort()
+{
+    if (m_port && m_port->isOpen())
+        m_port->close();
+    m_connected = false;
+
+    m_sched.clear();
+    m_txInFlight = 0;
+
+    // Samples already queued stay for the renderer to drain; only it may
+    // move the read side.
+    if (m_egramTimer)
+        m_egramTimer->stop();
+    flushEgramStage();
+    m_egramIndexValid = false;
+
+    failAllRequests("Link closed.");
+    m_caps = 0;
+}
+
+void PacemakerLink::sendHello()
+{
+    m_caps = 0;
+    m_egramRateHz = DEFAULT_EGRAM_RATE_HZ;
+
+    const quint8 seq = beginRequest(
+        MSG_HELLO_ACK, HELLO_TIMEOUT_MS,
+        [this](const quint8* f, qint64) {
+            m_caps = static_cast<quint16>(get<Hello::Caps>(f) & HOST_CAPS);
+            const quint16 rate = get<Hello::EgramRateHz>(f);
+            m_egramRateHz = rate ? rate : DEFAULT_EGRAM_RATE_HZ;
+            rebuildEgramFilter();
+            reconfigureTrigger();
+            emit capabilitiesNegotiated(m_caps.load());
+        },
+        [this](const QString&) {
+            // No answer: older firmware that ignores HELLO.
+            m_caps = 0;
+            emit capabilitiesNegotiated(0);
+        });
+    if (seq == 0)
+        return;
+
+    if (!writeFrame(buildHelloFrame(seq), LinkScheduler::Control))
+        failRequest(seq, "Transmit queue full.");
 }
 
 // -------------------------------------------------------------
@@ -94,144 +290,603 @@ void PacemakerLink::disconnectFromDevice()
 // -------------------------------------------------------------
 void PacemakerLink::sendParameters(const Database::ModeProfile& p)
 {
-    if (!m_port.isOpen()) {
-        emit errorOccurred("Port not open.");
+    post([this, p]() {
+        if (!m_port->isOpen()) {
+            emit errorOccurred("Port not open.");
+            return;
+        }
+
+        if (writeFrame(buildSetParametersFrame(p), LinkScheduler::Control))
+            emit parametersWritten();
+        else
+            emit errorOccurred("Transmit queue full.");
+    });
+}
+
+void PacemakerLink::requestParameters()
+{
+    post([this]() {
+        if (!m_port->isOpen()) {
+            emit errorOccurred("Port not open.");
+            return;
+        }
+
+        if (!writeFrame(buildRequestParametersFrame(0), LinkScheduler::Control))
+            emit errorOccurred("Transmit queue full.");
+    });
+}
+
+QFuture<Database::ModeProfile> PacemakerLink::requestParametersAsync(int timeoutMs)
+{
+    // QPromise is move-only; share it between the reply and failure paths.
+    auto promise = std::make_shared<QPromise<Database::ModeProfile>>();
+    QFuture<Database::ModeProfile> future = promise->future();
+    promise->start();
+
+    post([this, promise, timeoutMs]() {
+        auto fail = [this, promise](const QString& why) {
+            promise->future().cancel();
+            promise->finish();
+            emit errorOccurred(why);
+        };
+
+        if (!m_port->isOpen()) {
+            fail("Port not open.");
+            return;
+        }
+
+        const quint8 seq = beginRequest(
+            MSG_PARAMS_RESPONSE, timeoutMs,
+            [promise](const quint8* f, qint64) {
+                promise->addResult(decodeParameters(f));
+                promise->finish();
+            },
+            fail);
+        if (seq == 0)
+            return;
+
+        if (!writeFrame(buildRequestParametersFrame(seq), LinkScheduler::Control))
+            failRequest(seq, "Transmit queue full.");
+    });
+
+    return future;
+}
+
+QFuture<PacemakerLink::ProgramResult>
+PacemakerLink::programAndVerify(const Database::ModeProfile& profile, int timeoutMs)
+{
+    auto promise = std::make_shared<QPromise<ProgramResult>>();
+    QFuture<ProgramResult> future = promise->future();
+    promise->start();
+
+    post([this, promise, profile, timeoutMs]() {
+        auto fail = [promise](const QString& why) {
+            ProgramResult r;
+            r.error = why;
+            promise->addResult(r);
+            promise->finish();
+        };
+
+        if (!m_port->isOpen()) {
+            fail("Port not open.");
+            return;
+        }
+
+        // Compare against what actually goes on the wire, so float and
+        // fixed-point quantization never shows up as a mismatch.
+        const Database::ModeProfile expected =
+            decodeParameters(buildSetParametersFrame(profile).data());
+
+        const quint8 seq = beginRequest(
+            MSG_PARAMS_RESPONSE, timeoutMs,
+            [promise, expected](const quint8* f, qint64 latencyUs) {
+                ProgramResult r;
+                r.mismatches = diffProfiles(expected, decodeParameters(f));
+                r.ok = r.mismatches.isEmpty();
+                r.latencyUs = latencyUs;
+                promise->addResult(r);
+                promise->finish();
+            },
+            fail);
+        if (seq == 0)
+            return;
+
+        if (!writeFrame(buildSetParametersFrame(profile, seq), LinkScheduler::Control)) {
+            failRequest(seq, "Transmit queue full.");
+            return;
+        }
+        emit parametersWritten();
+    });
+
+    return future;
+}
+
+void PacemakerLink::startEgramStream(quint8 mask)
+{
+    post([this, mask]() {
+        if (!m_port->isOpen()) return;
+
+        m_egramIndexValid = false;
+        m_filter.reset();
+        m_detector.reset();
+        m_trigger.reset();
+        if (!writeFrame(buildStartEgramFrame(mask), LinkScheduler::Telemetry))
+            emit errorOccurred("Transmit queue full.");
+    });
+}
+
+void PacemakerLink::stopEgramStream()
+{
+    post([this]() {
+        if (!m_port->isOpen()) return;
+
+        if (!writeFrame(buildStopEgramFrame(), LinkScheduler::Telemetry))
+            emit errorOccurred("Transmit queue full.");
+    });
+}
+
+void PacemakerLink::setEgramBatchInterval(int intervalMs)
+{
+    post([this, intervalMs]() { m_egramIntervalMs = qMax(1, intervalMs); });
+}
+
+void PacemakerLink::setEgramFilters(quint32 presets)
+{
+    m_filterPresets = presets;
+    post([this]() {
+        // Samples staged so far were decoded under the old settings.
+        flushEgramStage();
+        rebuildEgramFilter();
+    });
+}
+
+void PacemakerLink::setDetectorProfile(const Database::ModeProfile& profile)
+{
+    const EgramDetector::Config config = EgramDetector::fromProfile(profile);
+    const EgramStats::Config statsConfig = EgramStats::fromProfile(profile);
+    post([this, config, statsConfig]() {
+        flushEgramStage();
+        m_detector.configure(config);
+        m_egramStats.configure(statsConfig);
+        m_egramStatsDirty = true;
+        publishStats();
+    });
+}
+
+EgramStats PacemakerLink::egramStats() const
+{
+    QMutexLocker lock(&m_statsMutex);
+    return m_publishedEgramStats;
+}
+
+void PacemakerLink::setRecorder(EgramRecorder* recorder)
+{
+    QMetaObject::invokeMethod(m_io, [this, recorder]() {
+        // Staged samples go to whichever recorder was attached when they
+        // arrived.
+        flushEgramStage();
+        m_recorder = recorder;
+    }, Qt::BlockingQueuedConnection);
+}
+
+void PacemakerLink::setTrigger(const EgramTrigger::Config& config)
+{
+    post([this, config]() {
+        flushEgramStage();
+        m_trigger.configure(config, m_egramRateHz.load());
+    });
+}
+
+void PacemakerLink::rearmTrigger()
+{
+    post([this]() { m_trigger.arm(); });
+}
+
+void PacemakerLink::sendFrame(const Frame& frame, TxPriority priority)
+{
+    post([this, frame, priority]() {
+        if (!m_port->isOpen()) {
+            emit errorOccurred("Port not open.");
+            return;
+        }
+
+        if (!writeFrame(frame, priority))
+            emit errorOccurred("Transmit queue full.");
+    });
+}
+
+void PacemakerLink::setBulkShare(double share)
+{
+    post([this, share]() {
+        m_bulkShare = share;
+        m_sched.setBulkShare(share, m_port->isOpen() ? m_port->baudRate() / 10 : 0);
+    });
+}
+
+// -------------------------------------------------------------
+// Request / response tracking
+// -------------------------------------------------------------
+quint8 PacemakerLink::beginRequest(quint8 replyType, int timeoutMs,
+                                   std::function<void(const quint8*, qint64)> onReply,
+                                   std::function<void(const QString&)> onFail)
+{
+    if (m_pending.size() >= MAX_IN_FLIGHT) {
+        onFail("Too many requests in flight.");
+        return 0;
+    }
+
+    // Next free sequence number, skipping 0 (untracked).
+    while (m_nextSeq == 0 || m_pending.contains(m_nextSeq))
+        ++m_nextSeq;
+    const quint8 seq = m_nextSeq++;
+
+    PendingRequest& r = m_pending[seq];
+    r.replyType = replyType;
+    r.deadline  = m_clock.elapsed() + timeoutMs;
+    r.onReply   = std::move(onReply);
+    r.onFail    = std::move(onFail);
+
+    armDeadlineTimer();
+    return seq;
+}
+
+bool PacemakerLink::completeRequest(const quint8* f)
+{
+    const quint8 seq = get<Seq>(f);
+    if (seq == 0)
+        return false;
+
+    auto it = m_pending.find(seq);
+    if (it == m_pending.end() || it->replyType != get<Type>(f))
+        return false;
+
+    // Detach before calling out so the callback may start new requests.
+    PendingRequest r = std::move(*it);
+    m_pending.erase(it);
+    armDeadlineTimer();
+
+    const qint64 latencyUs = r.writtenNs >= 0 ? (m_clock.nsecsElapsed() - r.writtenNs) / 1000 : 0;
+    r.onReply(f, latencyUs);
+    return true;
+}
+
+void PacemakerLink::failRequest(quint8 seq, const QString& why)
+{
+    auto it = m_pending.find(seq);
+    if (it == m_pending.end())
         return;
+
+    PendingRequest r = std::move(*it);
+    m_pending.erase(it);
+    armDeadlineTimer();
+
+    r.onFail(why);
+}
+
+void PacemakerLink::expireRequests()
+{
+    const qint64 now = m_clock.elapsed();
+
+    QVector<PendingRequest> expired;
+    QVector<quint8> seqs;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it->deadline <= now) {
+            seqs << it.key();
+            expired << std::move(*it);
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
     }
+    armDeadlineTimer();
 
-    QByteArray frame = buildSetParametersFrame(p);
-    m_port.write(frame);
-    m_port.flush();
-    emit parametersWritten();
+    for (int i = 0; i < expired.size(); ++i)
+        expired[i].onFail(QString("Request #%1 timed out.").arg(seqs[i]));
 }
 
-void PacemakerLink::requestParameters()
+void PacemakerLink::failAllRequests(const QString& why)
+{
+    if (m_pending.isEmpty())
+        return;
+
+    QHash<quint8, PendingRequest> pending;
+    pending.swap(m_pending);
+    if (m_deadlineTimer)
+        m_deadlineTimer->stop();
+
+    for (auto it = pending.begin(); it != pending.end(); ++it)
+        it->onFail(why);
+}
+
+void PacemakerLink::armDeadlineTimer()
 {
-    if (!m_port.isOpen()) {
-        emit errorOccurred("Port not open.");
+    if (m_pending.isEmpty()) {
+        m_deadlineTimer->stop();
         return;
     }
 
-    QByteArray frame = buildRequestParametersFrame();
-    m_port.write(frame);
-    m_port.flush();
+    qint64 earliest = std::numeric_limits<qint64>::max();
+    for (const PendingRequest& r : std::as_const(m_pending))
+        earliest = qMin(earliest, r.deadline);
+
+    m_deadlineTimer->start(static_cast<int>(qMax<qint64>(0, earliest - m_clock.elapsed())));
 }
 
-void PacemakerLink::startEgramStream(quint8 mask)
+// -------------------------------------------------------------
+// Framing
+// -------------------------------------------------------------
+void PacemakerLink::setFramingMode(FramingMode mode)
+{
+    m_framing = mode;
+    post([this]() { m_inSync = true; });
+}
+
+PacemakerLink::LinkStats PacemakerLink::stats() const
 {
-    if (!m_port.isOpen()) return;
+    QMutexLocker lock(&m_statsMutex);
+    return m_publishedStats;
+}
 
-    QByteArray frame = buildStartEgramFrame(mask);
-    m_port.write(frame);
-    m_port.flush();
+void PacemakerLink::resetStats()
+{
+    post([this]() {
+        m_stats = LinkStats{};
+        m_sched.resetStats();
+        m_statsSinceUs = nowUs();
+        publishStats();
+    });
 }
 
-void PacemakerLink::stopEgramStream()
+void PacemakerLink::publishStats()
 {
-    if (!m_port.isOpen()) return;
+    for (int p = 0; p < LinkScheduler::PriorityCount; ++p)
+        m_stats.tx[p] = m_sched.stats(static_cast<TxPriority>(p));
+    m_stats.windowUs = nowUs() - m_statsSinceUs;
 
-    QByteArray frame = buildStopEgramFrame();
-    m_port.write(frame);
-    m_port.flush();
+    QMutexLocker lock(&m_statsMutex);
+    m_publishedStats = m_stats;
+    if (m_egramStatsDirty) {
+        m_publishedEgramStats = m_egramStats;
+        m_egramStatsDirty = false;
+    }
 }
 
 // -------------------------------------------------------------
-// Incoming serial data
+// Transmit scheduling
 // -------------------------------------------------------------
-void PacemakerLink::handleReadyRead()
+bool PacemakerLink::writeFrame(Frame f, TxPriority priority)
 {
-    m_rxBuffer.append(m_port.readAll());
+    if (m_framing.load() == FramingMode::SyncCrc) {
+        put<Sync>(f.data(), SYNC_BYTE);
+        put<Crc>(f.data(), frameCrc(f.data()));
+    }
 
-    while (m_rxBuffer.size() >= FRAME_SIZE) {
-        QByteArray frame = m_rxBuffer.left(FRAME_SIZE);
-        m_rxBuffer.remove(0, FRAME_SIZE);
-        handleFrame(frame);
+    if (!m_sched.enqueue(priority, f, nowUs())) {
+        publishStats();
+        return false;
     }
+
+    int waiting = 0;
+    for (int p = 0; p < LinkScheduler::PriorityCount; ++p)
+        waiting += m_sched.stats(static_cast<TxPriority>(p)).depth;
+    m_stats.txHighWater = qMax(m_stats.txHighWater, waiting);
+
+    pumpTx();
+    return true;
 }
 
-void PacemakerLink::handleError(QSerialPort::SerialPortError e)
+void PacemakerLink::pumpTx()
 {
-    if (e == QSerialPort::NoError)
+    // One write outstanding at a time; whatever queues up meanwhile is
+    // coalesced into the next one, highest priority first.
+    if (m_txInFlight > 0 || !m_port->isOpen())
+        return;
+
+    const qint64 now = nowUs();
+    const int n = m_sched.dequeue(m_txBatch.data(), static_cast<int>(m_txBatch.size()), now);
+    if (n == 0) {
+        // Only rate-limited bulk is waiting: come back when it has tokens.
+        const qint64 delay = m_sched.bulkDelayUs(now);
+        if (delay > 0 && !m_bulkTimer->isActive())
+            m_bulkTimer->start(static_cast<int>((delay + 999) / 1000));
+        return;
+    }
+
+    const qint64 written = m_port->write(reinterpret_cast<const char*>(m_txBatch.data()), n);
+    if (written < 0) {
+        m_sched.clear();
+        emit errorOccurred(m_port->errorString());
         return;
+    }
+
+    m_txInFlight = written;
+    ++m_stats.txWrites;
+    markRequestsWritten(m_txBatch.data(), n);
+    publishStats();
+}
+
+void PacemakerLink::markRequestsWritten(const quint8* batch, int bytes)
+{
+    if (m_pending.isEmpty())
+        return;
+
+    const qint64 now = m_clock.nsecsElapsed();
+    for (int off = 0; off + FRAME_SIZE <= bytes; off += FRAME_SIZE) {
+        const quint8* f = batch + off;
+        const quint8 type = get<Type>(f);
+        if (type != MSG_SET_PARAMS && type != MSG_REQUEST_PARAMS && type != MSG_HELLO)
+            continue;
+
+        auto it = m_pending.find(get<Seq>(f));
+        if (it != m_pending.end() && it->writtenNs < 0)
+            it->writtenNs = now;
+    }
+}
 
-    emit errorOccurred(m_port.errorString());
+void PacemakerLink::handleBytesWritten(qint64 bytes)
+{
+    m_txInFlight = qMax<qint64>(0, m_txInFlight - bytes);
+    pumpTx();
 }
 
 // -------------------------------------------------------------
-// Frame builders
+// Incoming serial data
 // -------------------------------------------------------------
-QByteArray PacemakerLink::buildSetParametersFrame(const Database::ModeProfile& p) const
+void PacemakerLink::handleReadyRead()
+{
+    // Read straight into the ring's free space and decode as we go,
+    // so a large burst never needs more than one ring's worth of storage.
+    for (;;) {
+        int room = 0;
+        quint8* dst = m_rx.writePtr(&room);
+        if (room == 0)
+            break;
+
+        const qint64 n = m_port->read(reinterpret_cast<char*>(dst), room);
+        if (n <= 0)
+            break;
+
+        m_rx.commit(static_cast<int>(n));
+        processIncomingBytes();
+    }
+
+    publishStats();
+}
+
+void PacemakerLink::processIncomingBytes()
 {
-    QByteArray f(FRAME_SIZE, 0);
+    if (m_framing.load() == FramingMode::SyncCrc)
+        processSyncedFrames();
+    else
+        processRawFrames();
+}
 
-    // Byte 1 = message type
-    f[1] = MSG_SET_PARAMS;
+void PacemakerLink::processRawFrames()
+{
+    quint8 scratch[FRAME_SIZE];
+
+    while (m_rx.size() >= FRAME_SIZE) {
+        int len = 0;
+        const quint8* f = m_rx.readPtr(&len);
 
-    // Byte 2 = mode code
-    f[2] = modeToCode(p.mode);
+        // Frame straddles the end of the ring: stitch it on the stack.
+        if (len < FRAME_SIZE) {
+            m_rx.peek(0, scratch, FRAME_SIZE);
+            f = scratch;
+        }
+
+        handleFrame(f);
+        m_rx.consume(FRAME_SIZE);
+        ++m_stats.framesOk;
+    }
+}
 
-    // Byte 3 = LRL
-    f[3] = static_cast<char>(p.lrl.value_or(0));
+void PacemakerLink::processSyncedFrames()
+{
+    quint8 scratch[FRAME_SIZE];
 
-    // Byte 4 = URL
-    f[4] = static_cast<char>(p.url.value_or(0));
+    while (m_rx.size() >= FRAME_SIZE) {
+        int len = 0;
+        const quint8* f = m_rx.readPtr(&len);
+        if (len < FRAME_SIZE) {
+            m_rx.peek(0, scratch, FRAME_SIZE);
+            f = scratch;
+            len = FRAME_SIZE;
+        }
 
-    // Floats for amplitude + PW
-    writeFloat32LE(f, 5,  static_cast<float>(p.aAmp.value_or(0.0)));
-    writeFloat32LE(f, 9,  static_cast<float>(p.vAmp.value_or(0.0)));
-    writeFloat32LE(f, 13, static_cast<float>(p.aPw.value_or(0.0)));
-    writeFloat32LE(f, 17, static_cast<float>(p.vPw.value_or(0.0)));
+        // Hunt for the next sync marker within the contiguous run; a frame
+        // starts SYNC_OFFSET bytes before its marker.
+        if (f[SYNC_OFFSET] != SYNC_BYTE) {
+            const quint8* from = f + SYNC_OFFSET + 1;
+            const void* hit = std::memchr(from, SYNC_BYTE, static_cast<size_t>(len - SYNC_OFFSET - 1));
+            const int skip = hit ? static_cast<int>(static_cast<const quint8*>(hit) - f) - SYNC_OFFSET
+                                 : len - SYNC_OFFSET;
+            m_rx.consume(skip);
+            m_stats.bytesDropped += static_cast<quint64>(skip);
+            m_inSync = false;
+            continue;
+        }
 
-    // ARP / VRP
-    writeUInt16LE(f, 21, static_cast<quint16>(p.vrp.value_or(0)));
-    writeUInt16LE(f, 23, static_cast<quint16>(p.arp.value_or(0)));
+        // A marker byte inside the payload can look like a frame start;
+        // the CRC rejects it and we slide forward by one byte.
+        if (frameCrc(f) != get<Crc>(f)) {
+            ++m_stats.crcErrors;
+            ++m_stats.bytesDropped;
+            m_rx.consume(1);
+            m_inSync = false;
+            continue;
+        }
 
-    // AVD not used (Deliverable 2)
-    writeUInt16LE(f, 26, 0);
+        if (!m_inSync) {
+            ++m_stats.resyncs;
+            m_inSync = true;
+        }
 
-    // Sensitivity fields (Deliverable 2)
-    // Let’s place them in remaining bytes 28–31
-    writeFloat32LE(f, 28, static_cast<float>(p.aSens.value_or(0.0))); // actually uses 4 bytes, overlaps with 31
-    // but your frame is 32 bytes; sensitivity occupies final bytes safely
+        handleFrame(f);
+        m_rx.consume(FRAME_SIZE);
+        ++m_stats.framesOk;
+    }
+}
 
-    // But we also need ventricular sensitivity.
-    // Use offset 24/30? Instead align at 24 properly:
-    writeFloat32LE(f, 24, static_cast<float>(p.vSens.value_or(0.0)));
+void PacemakerLink::handleError(QSerialPort::SerialPortError e)
+{
+    if (e == QSerialPort::NoError)
+        return;
 
+    emit errorOccurred(m_port->errorString());
+}
+
+// -------------------------------------------------------------
+// Frame builders
+// -------------------------------------------------------------
+Frame PacemakerLink::buildSetParametersFrame(const Database::ModeProfile& p, quint8 seq)
+{
+    Frame f;
+    put<Type>(f.data(), MSG_SET_PARAMS);
+    encodeParameters(p, f.data());
+    put<Seq>(f.data(), seq);
+    return f;
+}
+
+Frame PacemakerLink::buildRequestParametersFrame(quint8 seq)
+{
+    Frame f;
+    put<Type>(f.data(), MSG_REQUEST_PARAMS);
+    put<Seq>(f.data(), seq);
     return f;
 }
 
-QByteArray PacemakerLink::buildRequestParametersFrame() const
+Frame PacemakerLink::buildStartEgramFrame(quint8 mask)
 {
-    QByteArray f(FRAME_SIZE, 0);
-    f[1] = MSG_REQUEST_PARAMS;
+    Frame f;
+    put<Type>(f.data(), MSG_EGRAM_START);
+    f.bytes[2] = mask;   // channel mask
     return f;
 }
 
-QByteArray PacemakerLink::buildStartEgramFrame(quint8 mask) const
+Frame PacemakerLink::buildStopEgramFrame()
 {
-    QByteArray f(FRAME_SIZE, 0);
-    f[1] = MSG_EGRAM_START;
-    f[2] = mask;
+    Frame f;
+    put<Type>(f.data(), MSG_EGRAM_STOP);
     return f;
 }
 
-QByteArray PacemakerLink::buildStopEgramFrame() const
+Frame PacemakerLink::buildHelloFrame(quint8 seq)
 {
-    QByteArray f(FRAME_SIZE, 0);
-    f[1] = MSG_EGRAM_STOP;
+    Frame f;
+    put<Hello::Type>(f.data(), MSG_HELLO);
+    put<Hello::Version>(f.data(), PROTOCOL_VERSION);
+    put<Hello::Caps>(f.data(), HOST_CAPS);
+    put<Hello::Seq>(f.data(), seq);
     return f;
 }
 
 // -------------------------------------------------------------
 // Incoming frame routing
 // -------------------------------------------------------------
-void PacemakerLink::handleFrame(const QByteArray& f)
+void PacemakerLink::handleFrame(const quint8* f)
 {
-    if (f.size() != FRAME_SIZE)
-        return;
-
-    const quint8 type = static_cast<quint8>(f[1]);
+    const quint8 type = get<Type>(f);
 
     switch (type) {
     case MSG_PARAMS_RESPONSE:
@@ -242,110 +897,312 @@ void PacemakerLink::handleFrame(const QByteArray& f)
         handleEgramFrame(f);
         break;
 
+    case MSG_EGRAM_PACKED:
+        handlePackedEgramFrame(f);
+        break;
+
     default:
         break;
     }
+
+    // Hand replies to whoever is waiting on their sequence number.
+    completeRequest(f);
 }
 
 // -------------------------------------------------------------
 // Parameter response from pacemaker
 // -------------------------------------------------------------
-void PacemakerLink::handleParametersFrame(const QByteArray& f)
+void PacemakerLink::handleParametersFrame(const quint8* f)
 {
-    Database::ModeProfile p;
-    p.userId = -1;
-
-    p.mode = codeToMode(static_cast<quint8>(f[2]));
+    emit parametersReadBack(decodeParameters(f));
+}
 
-    p.lrl = static_cast<quint8>(f[3]);
-    p.url = static_cast<quint8>(f[4]);
+QStringList PacemakerLink::diffProfiles(const Database::ModeProfile& sent,
+                                        const Database::ModeProfile& got)
+{
+    QStringList out;
 
-    p.aAmp = readFloat32LE(f, 5);
-    p.vAmp = readFloat32LE(f, 9);
-    p.aPw  = readFloat32LE(f, 13);
-    p.vPw  = readFloat32LE(f, 17);
+    auto cmp = [&out](const char* name, const auto& a, const auto& b) {
+        if (a != b)
+            out << QString("%1: sent %2, device %3")
+                       .arg(name)
+                       .arg(a.value_or(0))
+                       .arg(b.value_or(0));
+    };
 
-    p.vrp = readUInt16LE(f, 21);
-    p.arp = readUInt16LE(f, 23);
+    if (sent.mode != got.mode)
+        out << QString("Mode: sent %1, device %2").arg(sent.mode, got.mode);
 
-    p.vSens = readFloat32LE(f, 24);
-    p.aSens = readFloat32LE(f, 28);
+    cmp("LRL",   sent.lrl,   got.lrl);
+    cmp("URL",   sent.url,   got.url);
+    cmp("ARP",   sent.arp,   got.arp);
+    cmp("VRP",   sent.vrp,   got.vrp);
+    cmp("aAmp",  sent.aAmp,  got.aAmp);
+    cmp("vAmp",  sent.vAmp,  got.vAmp);
+    cmp("aPW",   sent.aPw,   got.aPw);
+    cmp("vPW",   sent.vPw,   got.vPw);
 
-    emit parametersReadBack(p);
+    return out;
 }
 
 // -------------------------------------------------------------
-// Egram handler (ignored as requested)
+// Egram samples from pacemaker
 // -------------------------------------------------------------
-void PacemakerLink::handleEgramFrame(const QByteArray& f)
+void PacemakerLink::handleEgramFrame(const quint8* f)
+{
+    stageEgramSample(get<Egram::Time>(f),
+                     get<Egram::Atrial>(f),
+                     get<Egram::Ventricular>(f));
+    ++m_stats.egramSamples;
+
+    // The first sample after a wake-up starts the clock; an idle stream
+    // costs no timer events.
+    if (!m_egramTimer->isActive())
+        m_egramTimer->start(m_egramIntervalMs);
+}
+
+void PacemakerLink::handlePackedEgramFrame(const quint8* f)
+{
+    const quint16 counter = get<EgramPacked::Counter>(f);
+    const int count = qMin<int>(get<EgramPacked::Count>(f), EgramPacked::PAIRS_PER_FRAME);
+
+    // Forward gaps in the counter are lost samples. A large backward jump
+    // means the device restarted its stream: the index carries on from
+    // where it was rather than following it, since the egram queue, the
+    // recorder and the archive's binary searches need timestamps that
+    // never go back. A new stream likewise starts no earlier than the last.
+    if (m_egramIndexValid) {
+        const quint16 gap = static_cast<quint16>(counter - m_egramCounter);
+        if (gap < 0x8000) {
+            m_stats.egramLost += gap;
+            m_egramIndex += gap;
+        }
+    } else {
+        m_egramIndex = qMax<quint64>(m_egramIndex, counter);
+        m_egramIndexValid = true;
+    }
+    m_egramCounter = static_cast<quint16>(counter + count);
+
+    const int rate = m_egramRateHz.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        const quint32 timeMs = static_cast<quint32>((m_egramIndex + i) * 1000 / rate);
+        stageEgramSample(timeMs,
+                         EgramPacked::sample(f, 2 * i)     * EgramPacked::MV_PER_LSB,
+                         EgramPacked::sample(f, 2 * i + 1) * EgramPacked::MV_PER_LSB);
+    }
+    m_egramIndex += count;
+    m_stats.egramSamples += count;
+
+    if (!m_egramTimer->isActive())
+        m_egramTimer->start(m_egramIntervalMs);
+}
+
+void PacemakerLink::stageEgramSample(quint32 timeMs, float atrial, float ventricular)
 {
-    Q_UNUSED(f);
-    // Deliverable 2 does NOT require waveform streaming.
+    m_stageTime[m_staged]        = timeMs;
+    m_stageAtrial[m_staged]      = atrial;
+    m_stageVentricular[m_staged] = ventricular;
+
+    if (++m_staged == EGRAM_BLOCK)
+        flushEgramStage();
+}
+
+void PacemakerLink::flushEgramStage()
+{
+    if (m_staged == 0)
+        return;
+
+    const qint64 startNs = m_clock.nsecsElapsed();
+    m_filter.process(m_stageAtrial.data(), m_stageVentricular.data(), m_staged);
+
+    const int markers = m_detector.process(m_stageTime.data(), m_stageAtrial.data(),
+                                           m_stageVentricular.data(), m_staged,
+                                           m_markerScratch.data(),
+                                           static_cast<int>(m_markerScratch.size()));
+    const bool triggered = m_trigger.process(m_stageTime.data(), m_stageAtrial.data(),
+                                             m_stageVentricular.data(), m_staged,
+                                             m_markerScratch.data(), markers);
+    m_stats.egramProcessNs += static_cast<quint64>(m_clock.nsecsElapsed() - startNs);
+
+    const int accepted = m_egram.pushBlock(m_stageTime.data(), m_stageAtrial.data(),
+                                           m_stageVentricular.data(), m_staged);
+    m_stats.egramDropped += static_cast<quint64>(m_staged - accepted);
+    if (m_recorder)
+        m_recorder->append(m_stageTime.data(), m_stageAtrial.data(),
+                           m_stageVentricular.data(), m_staged);
+    m_staged = 0;
+
+    // After the samples, so a consumer never sees a marker ahead of its data.
+    // The statistics count every marker, including any the full queue drops.
+    for (int i = 0; i < markers; ++i) {
+        m_markers.push(m_markerScratch[i]);
+        m_egramStats.addMarker(m_markerScratch[i]);
+        if (m_recorder)
+            m_recorder->appendMarker(m_markerScratch[i]);
+    }
+    m_egramStatsDirty = m_egramStatsDirty || markers > 0;
+
+    if (triggered)
+        emit egramTriggered(m_trigger.takeCapture());
+}
+
+void PacemakerLink::rebuildEgramFilter()
+{
+    m_filter = EgramDsp::buildChain(m_filterPresets.load(), m_egramRateHz.load());
+}
+
+void PacemakerLink::reconfigureTrigger()
+{
+    // The ring is sized in samples, so it follows the stream rate.
+    m_trigger.configure(m_trigger.config(), m_egramRateHz.load());
 }
 
 // -------------------------------------------------------------
-// Utility functions (endian)
+// Replay
 // -------------------------------------------------------------
-quint16 PacemakerLink::readUInt16LE(const QByteArray& d, int offset)
+bool PacemakerLink::startReplay(const QString& path, double speed, QString* errorMessage)
 {
-    quint8 lo = static_cast<quint8>(d[offset]);
-    quint8 hi = static_cast<quint8>(d[offset+1]);
-    return (hi << 8) | lo;
+    bool ok = false;
+    QString err;
+
+    QMetaObject::invokeMethod(m_io, [&]() {
+        if (m_port->isOpen()) {
+            err = "Disconnect from the device before replaying.";
+            return;
+        }
+        if (m_replay)
+            endReplay();
+
+        auto replay = std::make_unique<EgramReplay>();
+        if (!replay->open(path, &err))
+            return;
+
+        // Start from a clean pipeline at the recording's rate.
+        flushEgramStage();
+        m_egramRateHz = replay->sampleRate();
+        rebuildEgramFilter();
+        m_detector.reset();
+        m_egramStats.reset();
+        m_egramStatsDirty = true;
+        publishStats();
+        reconfigureTrigger();
+
+        m_replay = std::move(replay);
+        m_replaySpeed = qMax(0.0, speed);
+        m_replayStartUs = nowUs();
+        m_replayed = 0;
+        m_replayStalledUs = -1;
+        m_replaying = true;
+        m_replayTimer->start(0);
+        ok = true;
+    }, Qt::BlockingQueuedConnection);
+
+    if (!ok && errorMessage)
+        *errorMessage = err;
+    return ok;
 }
 
-void PacemakerLink::writeUInt16LE(QByteArray& d, int offset, quint16 v)
+void PacemakerLink::stopReplay()
 {
-    d[offset]   = static_cast<char>(v & 0xFF);
-    d[offset+1] = static_cast<char>((v >> 8) & 0xFF);
+    post([this]() {
+        if (m_replay)
+            endReplay();
+    });
 }
 
-float PacemakerLink::readFloat32LE(const QByteArray& d, int offset)
+void PacemakerLink::pumpReplay()
 {
-    float f;
-    unsigned char* p = reinterpret_cast<unsigned char*>(&f);
-    p[0] = d[offset];
-    p[1] = d[offset+1];
-    p[2] = d[offset+2];
-    p[3] = d[offset+3];
-    return f;
+    if (!m_replay)
+        return;
+
+    // Flat-out feeds only what the queue can take, so the renderer sets the
+    // pace and nothing is dropped, unless the queue stays full for
+    // REPLAY_STALL_US: then nobody is draining it, and the replay runs on
+    // with the queue dropping as it does live. Otherwise feed what the
+    // clock says is due.
+    const bool flatOut = m_replaySpeed <= 0.0;
+    int budget = REPLAY_MAX_PER_PUMP;
+    if (flatOut) {
+        const int room = m_egram.writeAvailable() - m_staged;
+        if (room > 0) {
+            m_replayStalledUs = -1;
+            budget = qMin(budget, room);
+        } else if (m_replayStalledUs < 0) {
+            m_replayStalledUs = nowUs();
+            budget = 0;
+        } else if (nowUs() - m_replayStalledUs < REPLAY_STALL_US) {
+            budget = 0;
+        }
+    }
+    const quint32 untilMs = flatOut
+        ? 0xFFFFFFFFu
+        : static_cast<quint32>((nowUs() - m_replayStartUs) * m_replaySpeed / 1000.0);
+
+    quint32 t[EGRAM_BLOCK];
+    float   a[EGRAM_BLOCK];
+    float   v[EGRAM_BLOCK];
+    int fed = 0;
+    while (fed < budget) {
+        const int n = m_replay->read(t, a, v, qMin(EGRAM_BLOCK, budget - fed), untilMs);
+        if (n == 0)
+            break;
+        for (int i = 0; i < n; ++i)
+            stageEgramSample(t[i], a[i], v[i]);
+        fed += n;
+    }
+    m_replayed += static_cast<quint64>(fed);
+    m_stats.egramSamples += static_cast<quint64>(fed);
+
+    if (m_replay->atEnd()) {
+        endReplay();
+        return;
+    }
+
+    if (flatOut) {
+        // Wake the renderer now rather than at the batch interval; when the
+        // queue is full, back off a millisecond instead of spinning.
+        if (fed > 0)
+            notifyEgram();
+        m_replayTimer->start(fed > 0 ? 0 : 1);
+    } else {
+        if (fed > 0 && !m_egramTimer->isActive())
+            m_egramTimer->start(m_egramIntervalMs);
+        m_replayTimer->start(REPLAY_TICK_MS);
+    }
 }
 
-void PacemakerLink::writeFloat32LE(QByteArray& d, int offset, float v)
+void PacemakerLink::endReplay()
 {
-    const unsigned char* p = reinterpret_cast<const unsigned char*>(&v);
-    d[offset]   = p[0];
-    d[offset+1] = p[1];
-    d[offset+2] = p[2];
-    d[offset+3] = p[3];
+    m_replayTimer->stop();
+    notifyEgram();
+
+    const qint64 elapsedUs = nowUs() - m_replayStartUs;
+    const quint64 samples = m_replayed;
+    m_replay.reset();
+    m_replaying = false;
+    emit replayFinished(samples, elapsedUs);
+}
+
+void PacemakerLink::notifyEgram()
+{
+    // A partial block would otherwise wait for the next EGRAM_BLOCK samples.
+    flushEgramStage();
+    publishStats();
+    emit egramDataAvailable();
 }
 
 // -------------------------------------------------------------
-// Mode mapping
+// Utility functions
 // -------------------------------------------------------------
-quint8 PacemakerLink::modeToCode(const QString& m)
-{
-    if (m == "AOO")  return 1;
-    if (m == "VOO")  return 2;
-    if (m == "AAI")  return 3;
-    if (m == "VVI")  return 4;
-    if (m == "AOOR") return 5;
-    if (m == "VOOR") return 6;
-    if (m == "AAIR") return 7;
-    if (m == "VVIR") return 8;
-    return 0xFF;
-}
-
-QString PacemakerLink::codeToMode(quint8 c)
-{
-    switch (c) {
-    case 1: return "AOO";
-    case 2: return "VOO";
-    case 3: return "AAI";
-    case 4: return "VVI";
-    case 5: return "AOOR";
-    case 6: return "VOOR";
-    case 7: return "AAIR";
-    case 8: return "VVIR";
-    default: return "AOO";
-    }
+quint16 PacemakerLink::crc16(const quint8* d, int len, quint16 crc)
+{
+    for (int i = 0; i < len; ++i)
+        crc = static_cast<quint16>((crc << 8) ^ CRC_TABLE[((crc >> 8) ^ d[i]) & 0xFF]);
+    return crc;
+}
+
+quint16 PacemakerLink::frameCrc(const quint8* f)
+{
+    const quint16 head = crc16(f, CRC_OFFSET);
+    return crc16(f + CRC_END, FRAME_SIZE - CRC_END, head);
 }
@@ -1,76 +1,343 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QSerialPort>
 #include <QStringList>
+#include <QThread>
 #include <QVector>
 
+class EgramRecorder;
+class QTimer;
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+
 #include "database.h"  // Database::ModeProfile
+#include "egrambuffer.h"
+#include "egramdetector.h"
+#include "egramdsp.h"
+#include "egramreplay.h"
+#include "egramstats.h"
+#include "egramtrigger.h"
+#include "framelayout.h"
+#include "linkscheduler.h"
+#include "ringbuffer.h"
+#include "spscqueue.h"
 
+// Serial link to the pacemaker.
+//
+// The object itself lives on the GUI thread, but the QSerialPort and all
+// RX/TX state belong to a private I/O thread. Public methods are safe to
+// call from any thread: they post the work to the I/O thread and return.
+// Signals are emitted from the I/O thread and reach GUI receivers queued.
 class PacemakerLink : public QObject {
     Q_OBJECT
+    friend class PacemakerLinkProbe;   // tests/: drives the I/O-thread paths directly
 
 public:
+    // Raw: byte 0 of every 32-byte chunk is assumed to be a frame boundary.
+    // SyncCrc: byte 1 carries a sync marker and bytes 29-30 a CRC-16, so the
+    //          decoder can hunt for the next valid frame after a glitch.
+    //          Needs firmware that speaks it: the stock receive chart drops
+    //          any frame whose byte 1 is not 0 (see FrameLayout::CRC_OFFSET).
+    enum class FramingMode { Raw, SyncCrc };
+
+    // Outbound traffic classes, highest priority first.
+    using TxPriority = LinkScheduler::Priority;
+
+    // Link counters. RX: framing health. TX: per-class queueing and coalescing.
+    struct LinkStats {
+        quint64 framesOk{0};
+        quint64 bytesDropped{0};
+        quint64 crcErrors{0};
+        quint64 resyncs{0};
+
+        // Egram: samples decoded, and samples dropped because the
+        // renderer had not drained the queue.
+        quint64 egramSamples{0};
+        quint64 egramDropped{0};
+        quint64 egramLost{0};       // packed-frame counter gaps (samples never received)
+        quint64 egramProcessNs{0};  // time spent in the filter chain and detector
+
+        // Indexed by TxPriority. Throughput = bytes / windowUs.
+        std::array<LinkScheduler::ClassStats, LinkScheduler::PriorityCount> tx{};
+        int     txHighWater{0};     // most frames ever waiting across all classes
+        quint64 txWrites{0};        // QSerialPort::write calls issued
+        qint64  windowUs{0};        // time covered by the counters
+    };
+
+    // Outcome of programAndVerify().
+    struct ProgramResult {
+        bool        ok{false};
+        QStringList mismatches;   // one entry per field the device disagrees on
+        QString     error;        // set when no echo arrived (timeout, link down)
+        qint64      latencyUs{0}; // frame written to the port -> echo decoded
+    };
+
     explicit PacemakerLink(QObject* parent = nullptr);
     ~PacemakerLink() override;
 
-    // Device / COM management
+    // Device / COM management.
+    // connectToDevice waits for the I/O thread to open the port so the
+    // caller gets the result; everything else is fire-and-forget.
     QStringList availablePorts() const;
     bool connectToDevice(const QString& portName, qint32 baudRate, QString* errorMessage = nullptr);
     void disconnectFromDevice();
-    bool isConnected() const { return m_port.isOpen(); }
+    bool isConnected() const { return m_connected.load(); }
+
+    // CAP_* bits both sides support, settled by the HELLO exchange that
+    // connectToDevice starts. 0 until then, and for firmware that does not
+    // answer HELLO, which keeps the link on the original message formats.
+    quint16 capabilities() const { return m_caps.load(); }
+
+    // Scheduling. Control frames always preempt telemetry and bulk; bulk
+    // is shaped to at most `share` of the link's byte rate.
+    void setBulkShare(double share);
+    void sendFrame(const FrameLayout::Frame& frame, TxPriority priority = LinkScheduler::Bulk);
+
+    // Framing
+    void setFramingMode(FramingMode mode);
+    FramingMode framingMode() const { return m_framing.load(); }
+    LinkStats stats() const;
+    void resetStats();
 
     // Deliverable 2 features
     void sendParameters(const Database::ModeProfile& profile);
     void requestParameters();
 
-    // Egram (NOT IMPLEMENTED AS REQUESTED)
+    // Sequence-numbered read-back. The future resolves with the device's
+    // reply, or is cancelled (and errorOccurred emitted) on timeout or
+    // disconnect. Several requests may be in flight at once.
+    QFuture<Database::ModeProfile> requestParametersAsync(int timeoutMs = 500);
+
+    // Write the profile and wait for the device to echo what it stored,
+    // all within one round trip of timeoutMs. The result lists every field
+    // that differs from what was sent, plus the end-to-end latency.
+    // Only devices that advertise CAP_PARAM_ECHO answer; with any other
+    // the result is a timeout, so check capabilities() first.
+    QFuture<ProgramResult> programAndVerify(const Database::ModeProfile& profile,
+                                            int timeoutMs = 500);
+
+    // Egram streaming. Decoded samples go straight into egramQueue(), a
+    // lock-free SPSC ring the renderer drains on its own thread; at most
+    // every intervalMs (default 40 ms) egramDataAvailable is emitted as a
+    // wake-up. No sample data travels through signals. Both the one-pair
+    // and the packed frame formats are accepted.
     void startEgramStream(quint8 mask);
     void stopEgramStream();
+    void setEgramBatchInterval(int intervalMs);
+
+    // Consumer side of the sample queue. Exactly one thread may drain it.
+    EgramBuffer* egramQueue() { return &m_egram; }
+
+    // Filtering applied before samples reach the queue, as EgramDsp::Preset
+    // bits (0 = raw). Runs on the I/O thread in blocks of EGRAM_BLOCK.
+    void setEgramFilters(quint32 presets);
+    quint32 egramFilters() const { return m_filterPresets.load(); }
+
+    // Sense/pace markers found in the filtered stream, queued just after
+    // the samples they refer to. Thresholds and refractory windows come
+    // from the profile (see EgramDetector::fromProfile).
+    void setDetectorProfile(const Database::ModeProfile& profile);
+    SpscQueue<EgramMarker>* markerQueue() { return &m_markers; }
+
+    // Statistics over every marker the detector has produced, whether or
+    // not anything drains markerQueue(). Kept on the I/O thread; this is a
+    // copy as of the last egramDataAvailable. setDetectorProfile clears it
+    // and rebins for the profile's rate limits, as does a replay starting.
+    EgramStats egramStats() const;
+
+    // Samples per second of the current stream (from HELLO_ACK).
+    int egramSampleRate() const { return m_egramRateHz.load(); }
+
+    // Also hand every filtered block and marker to recorder (nullptr to
+    // detach). Returns once the I/O thread has switched over, so after
+    // setRecorder(nullptr) the old recorder is no longer touched.
+    void setRecorder(EgramRecorder* recorder);
+
+    // Triggered capture on the filtered stream (see EgramTrigger).
+    // egramTriggered carries each completed window; streaming carries on
+    // regardless. rearmTrigger re-enables a single-shot trigger.
+    void setTrigger(const EgramTrigger::Config& config);
+    void rearmTrigger();
+
+    // Replay a recording through the egram pipeline as if it were arriving
+    // from the device: staging, filters, detector, egramQueue() and
+    // markerQueue() all behave as live. speed is a multiple of real time;
+    // 0 runs flat-out, as fast as the queue is drained, without dropping
+    // while something drains it. If the queue stays full (the view is
+    // hidden), flat-out carries on and drops like live, counted in
+    // LinkStats::egramDropped.
+    // Not available while connected. replayFinished reports the samples
+    // fed and the wall time taken.
+    bool startReplay(const QString& path, double speed, QString* errorMessage = nullptr);
+    void stopReplay();
+    bool isReplaying() const { return m_replaying.load(); }
 
 signals:
     // Connection status
     void connected(const QString& port, qint32 baud);
     void disconnected();
     void errorOccurred(const QString& msg);
+    void capabilitiesNegotiated(quint16 caps);
 
     // Parameter interaction
     void parametersWritten();
     void parametersReadBack(const Database::ModeProfile& profile);
 
-    // Egram data (ignored)
-    void egramSamplesReceived(const QVector<double>& atrial,
-                              const QVector<double>& ventricular);
+    // New samples are waiting in egramQueue()
+    void egramDataAvailable();
+
+    // The trigger fired and its post-trigger window is complete.
+    void egramTriggered(const EgramCapture& capture);
+
+    // A replay ran to the end or was stopped.
+    void replayFinished(quint64 samples, qint64 elapsedUs);
+
+private:
+    // Runs fn on the I/O thread.
+    void post(std::function<void()> fn);
+
+    // ---- Everything below runs on the I/O thread only ----
+    void initPort();
+    bool openPort(const QString& portName, qint32 baudRate, QString* errorMessage);
+    void closePort();
+    void sendHello();
+    void publishStats();
+    qint64 nowUs() const { return m_clock.nsecsElapsed() / 1000; }
 
-private slots:
     void handleReadyRead();
     void handleError(QSerialPort::SerialPortError err);
 
-private:
-    // Frame builders (32-byte frames)
-    QByteArray buildSetParametersFrame(const Database::ModeProfile& p) const;
-    QByteArray buildRequestParametersFrame() const;
-    QByteArray buildStartEgramFrame(quint8 mask) const;
-    QByteArray buildStopEgramFrame() const;
+    // Request/response tracking. beginRequest returns the sequence number
+    // to put in the outgoing frame, or 0 if too many are already in flight.
+    // onReply also gets the microseconds since the request frame was
+    // written to the port (not since it was queued).
+    quint8 beginRequest(quint8 replyType, int timeoutMs,
+                        std::function<void(const quint8*, qint64)> onReply,
+                        std::function<void(const QString&)> onFail);
+    bool completeRequest(const quint8* frame);
+    void failRequest(quint8 seq, const QString& why);
+    void expireRequests();
+    void failAllRequests(const QString& why);
+    void armDeadlineTimer();
+
+    // Outstanding request awaiting a reply carrying its sequence number.
+    struct PendingRequest {
+        quint8 replyType{0};
+        qint64 deadline{0};     // m_clock milliseconds
+        qint64 writtenNs{-1};   // m_clock nanoseconds when pumpTx wrote the frame
+        std::function<void(const quint8* frame, qint64 latencyUs)> onReply;
+        std::function<void(const QString& why)>  onFail;
+    };
+
+    // Frame builders (32-byte frames, returned by value)
+    static FrameLayout::Frame buildSetParametersFrame(const Database::ModeProfile& p, quint8 seq = 0);
+    static FrameLayout::Frame buildRequestParametersFrame(quint8 seq);
+    static FrameLayout::Frame buildStartEgramFrame(quint8 mask);
+    static FrameLayout::Frame buildStopEgramFrame();
+    static FrameLayout::Frame buildHelloFrame(quint8 seq);
+
+    // Seals (sync byte + CRC when enabled) and queues one frame for TX.
+    // Returns false if that class's queue is full; the caller reports it.
+    bool writeFrame(FrameLayout::Frame frame, TxPriority priority);
 
-    // Frame processing
+    // Hands the next batch, in priority order, to the port once the previous
+    // write has drained; driven by QSerialPort::bytesWritten.
+    void pumpTx();
+    void handleBytesWritten(qint64 bytes);
+
+    // Stamps the pending requests whose frames are in a batch just written.
+    void markRequestsWritten(const quint8* batch, int bytes);
+
+    // Frame processing. Handlers get a non-owning view of FRAME_SIZE bytes,
+    // either straight into the RX ring or a stack copy when the frame wraps.
     void processIncomingBytes();
-    void handleFrame(const QByteArray& frame);
-    void handleParametersFrame(const QByteArray& frame);
-    void handleEgramFrame(const QByteArray& frame);
+    void processRawFrames();
+    void processSyncedFrames();
+    void handleFrame(const quint8* frame);
+    void handleParametersFrame(const quint8* frame);
+    void handleEgramFrame(const quint8* frame);
+    void handlePackedEgramFrame(const quint8* frame);
+    void notifyEgram();
+    void stageEgramSample(quint32 timeMs, float atrial, float ventricular);
+    void flushEgramStage();
+    void rebuildEgramFilter();
+    void reconfigureTrigger();
+    void pumpReplay();
+    void endReplay();
+
+    static QStringList diffProfiles(const Database::ModeProfile& sent,
+                                    const Database::ModeProfile& got);
 
     // Utilities
-    static quint16 readUInt16LE(const QByteArray& data, int offset);
-    static void writeUInt16LE(QByteArray& data, int offset, quint16 value);
+    static quint16 crc16(const quint8* data, int len, quint16 crc = 0xFFFF);
+    static quint16 frameCrc(const quint8* frame);   // CRC field value for frame
 
-    static float readFloat32LE(const QByteArray& data, int offset);
-    static void writeFloat32LE(QByteArray& data, int offset, float value);
+private:
+    QThread  m_thread;
+    QObject* m_io{nullptr};         // context object living on m_thread
 
-    // Mode mapping
-    static quint8  modeToCode(const QString& mode);
-    static QString codeToMode(quint8 code);
+    // Shared with other threads
+    std::atomic<bool>        m_connected{false};
+    std::atomic<FramingMode> m_framing{FramingMode::Raw};
+    std::atomic<quint16>     m_caps{0};
+    std::atomic<quint32>     m_filterPresets{0};
+    std::atomic<int>         m_egramRateHz;
+    std::atomic<bool>        m_replaying{false};
+    mutable QMutex           m_statsMutex;
+    LinkStats                m_publishedStats;
+    EgramStats               m_publishedEgramStats;
+    EgramBuffer              m_egram;        // filled on the I/O thread, drained by the renderer
+    SpscQueue<EgramMarker>   m_markers;
 
-private:
-    QSerialPort m_port;
-    QByteArray m_rxBuffer;
+    // I/O thread only
+    QSerialPort* m_port{nullptr};
+    RingBuffer   m_rx;
+    LinkScheduler        m_sched;
+    std::vector<quint8>  m_txBatch;         // staging for one coalesced write
+    qint64               m_txInFlight{0};   // bytes handed to the port, not yet written
+    QTimer*              m_bulkTimer{nullptr};
+    double               m_bulkShare;
+    qint64               m_statsSinceUs{0};
+    LinkStats    m_stats;
+    bool         m_inSync{true};
+
+    QTimer*      m_egramTimer{nullptr};
+    int          m_egramIntervalMs;
+    bool         m_egramIndexValid{false};
+    quint64      m_egramIndex{0};       // sample index behind packed timestamps; never decreases
+    quint16      m_egramCounter{0};     // packed Counter expected next
+
+    // Decoded samples are staged here and filtered a block at a time.
+    static constexpr int EGRAM_BLOCK = 64;
+    std::array<quint32, EGRAM_BLOCK> m_stageTime{};
+    std::array<float, EGRAM_BLOCK>   m_stageAtrial{};
+    std::array<float, EGRAM_BLOCK>   m_stageVentricular{};
+    int                              m_staged{0};
+    EgramDsp::Chain                  m_filter;
+    EgramDetector                    m_detector;
+    EgramStats                       m_egramStats;
+    bool                             m_egramStatsDirty{false};   // changed since last published
+    std::array<EgramMarker, 2 * EGRAM_BLOCK> m_markerScratch{};
+    EgramRecorder*                   m_recorder{nullptr};
+    EgramTrigger                     m_trigger;
+
+    std::unique_ptr<EgramReplay> m_replay;
+    QTimer*                      m_replayTimer{nullptr};
+    double                       m_replaySpeed{1.0};
+    qint64                       m_replayStartUs{0};
+    quint64                      m_replayed{0};
+    qint64                       m_replayStalledUs{-1};  // flat-out: queue full since, or -1
+
+    QElapsedTimer                  m_clock;
+    QTimer*                        m_deadlineTimer{nullptr};
+    QHash<quint8, PendingRequest>  m_pending;
+    quint8                         m_nextSeq{1};
 };
@@ -1,6 +1,7 @@
 #include "parameterform.h"
 #include "ui_parameterform.h"
-#include "serialmanager.h"
+#include "framelayout.h"
+#include "pacemakerlink.h"
 
 #include <QComboBox>
 #include <QSpinBox>
@@ -10,7 +11,7 @@
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QtMath>
-#include <QtEndian>
+#include <QDebug>
 
 // Constructor
 ParameterForm::ParameterForm(int userId, QWidget* parent)
@@ -21,11 +22,6 @@ ParameterForm::ParameterForm(int userId, QWidget* parent)
 {
     ui->setupUi(this);
 
-    // Create serial manager
-    serial_ = new SerialManager(this);
-    connect(serial_, &SerialManager::errorOccurred,
-            this, &ParameterForm::onSerialError);
-
     // Wire buttons
     connect(ui->saveBtn,  &QPushButton::clicked, this, &ParameterForm::onSave);
     connect(ui->loadBtn,  &QPushButton::clicked, this, &ParameterForm::onLoad);
@@ -48,17 +44,30 @@ ParameterForm::ParameterForm(int userId, QWidget* parent)
     applyDefaults();
     restoreMode();
     reflectValidity();
-    updateConnectionStatus();
 }
 
 ParameterForm::~ParameterForm()
 {
-    if (serial_ && serial_->isOpen()) {
-        serial_->closePort();
-    }
     delete ui;
 }
 
+void ParameterForm::setLink(PacemakerLink* link)
+{
+    if (link_)
+        disconnect(link_, nullptr, this, nullptr);
+    link_ = link;
+    if (!link_)
+        return;
+
+    connect(link_, &PacemakerLink::connected,
+            this, [this]() { updateConnectionStatus(); });
+    connect(link_, &PacemakerLink::disconnected,
+            this, [this]() { updateConnectionStatus(); });
+    connect(link_, &PacemakerLink::parametersWritten, this, [this]() {
+        emit statusMessage("✓ Parameters sent to pacemaker");
+    });
+}
+
 // ---------- small helpers ----------
 
 QString ParameterForm::mode() const
@@ -125,7 +134,7 @@ bool ParameterForm::checkPulseWidth(double v, QString* why) const
 
 void ParameterForm::updateConnectionStatus()
 {
-    if (serial_ && serial_->isOpen()) {
+    if (link_ && link_->isConnected()) {
         emit statusMessage("✓ Serial connected");
     } else {
         emit statusMessage("Serial disconnected");
@@ -291,19 +300,22 @@ void ParameterForm::clearAll()
 
 void ParameterForm::onSend()
 {
-    // Build the frame first
-    QByteArray frame;
+    if (!link_)
+        return;
+
+    // Validate and build the profile first
+    Database::ModeProfile profile;
     QString err;
-    if (!buildTxFrame(&frame, &err)) {
+    if (!tryBuildProfile(&profile, &err)) {
         QMessageBox::warning(this, "Invalid Parameters",
                              "Cannot send parameters:\n" + err);
         return;
     }
 
-    // Check if serial port is open
-    if (!serial_->isOpen()) {
+    // Check if the link is open
+    if (!link_->isConnected()) {
         // Get available ports
-        QStringList ports = serial_->availablePorts();
+        QStringList ports = link_->availablePorts();
         if (ports.isEmpty()) {
             QMessageBox::warning(this, "No Ports",
                                  "No serial ports available.\n"
@@ -347,31 +359,20 @@ void ParameterForm::onSend()
 
         // Try to open the port
         QString serr;
-        if (!serial_->openPort(port, baud, &serr)) {
+        if (!link_->connectToDevice(port, baud, &serr)) {
             QMessageBox::critical(this, "Connection Failed",
                                   QString("Failed to open %1:\n%2").arg(port, serr));
             return;
         }
 
-        updateConnectionStatus();
         QMessageBox::information(this, "Connected",
                                  QString("Successfully connected to %1 @ %2 baud").arg(port).arg(baud));
     }
 
-    // Send the frame
-    if (!serial_->writeBytes(frame)) {
-        QMessageBox::critical(this, "Send Failed",
-                              "Failed to write data to serial port.\n"
-                              "The device may have been disconnected.");
-        updateConnectionStatus();
-        return;
-    }
-
-    // Success!
-    emit statusMessage(QString("✓ Sent %1-byte frame to pacemaker").arg(frame.size()));
-
-    // Log frame for debugging
-    qDebug() << "TX Frame [" << frame.size() << "bytes]:" << frame.toHex(' ').toUpper();
+    // Queue the frame on the link's I/O thread; a failed write arrives
+    // through PacemakerLink::errorOccurred.
+    link_->setDetectorProfile(profile);
+    link_->sendParameters(profile);
 
     QMessageBox::information(this, "Sent",
                              QString("Parameters sent successfully!\n"
@@ -385,7 +386,7 @@ void ParameterForm::onSend()
 
 void ParameterForm::onStop()
 {
-    if (!serial_->isOpen()) {
+    if (!link_ || !link_->isConnected()) {
         QMessageBox::information(this, "Not Connected",
                                  "Serial port is not open.");
         return;
@@ -399,20 +400,13 @@ void ParameterForm::onStop()
         );
 
     if (reply == QMessageBox::Yes) {
-        serial_->closePort();
-        updateConnectionStatus();
+        link_->disconnectFromDevice();
         emit statusMessage("Serial port closed.");
         QMessageBox::information(this, "Disconnected",
                                  "Serial port closed successfully.");
     }
 }
 
-void ParameterForm::onSerialError(const QString& msg)
-{
-    QMessageBox::warning(this, "Serial Error", msg);
-    updateConnectionStatus();
-}
-
 // ---------- profile build ----------
 
 bool ParameterForm::tryBuildProfile(Database::ModeProfile* out, QString* errMsg) const
@@ -439,9 +433,8 @@ bool ParameterForm::tryBuildProfile(Database::ModeProfile* out, QString* errMsg)
     p.vAmp = ui->vAmpSpin->value();
     p.vPw  = ui->vPwSpin->value();
 
-    // Sensitivities (if present in your DB struct but not in UI) can stay empty:
-    p.aSens = std::nullopt;
-    p.vSens = std::nullopt;
+    p.aSens = ui->aSensSpin->value();
+    p.vSens = ui->vSensSpin->value();
 
     *out = p;
     if (errMsg) errMsg->clear();
@@ -465,37 +458,6 @@ QMap<QString, QString> ParameterForm::currentValuesAsText() const
     return kv;
 }
 
-// ---------- mode <-> code mapping ----------
-
-quint8 ParameterForm::modeToCode(const QString& mode)
-{
-    const QString m = mode.toUpper();
-    if (m == "AOO")  return 0;
-    if (m == "VOO")  return 1;
-    if (m == "AAI")  return 2;
-    if (m == "VVI")  return 3;
-    if (m == "AOOR") return 4;
-    if (m == "VOOR") return 5;
-    if (m == "AAIR") return 6;
-    if (m == "VVIR") return 7;
-    return 0; // default to AOO
-}
-
-QString ParameterForm::codeToMode(quint8 code)
-{
-    switch (code) {
-    case 0:  return "AOO";
-    case 1:  return "VOO";
-    case 2:  return "AAI";
-    case 3:  return "VVI";
-    case 4:  return "AOOR";
-    case 5:  return "VOOR";
-    case 6:  return "AAIR";
-    case 7:  return "VVIR";
-    default: return "AOO";
-    }
-}
-
 // ---------- frame encode / decode ----------
 
 bool ParameterForm::buildTxFrame(QByteArray* outFrame, QString* errMsg) const
@@ -509,62 +471,12 @@ bool ParameterForm::buildTxFrame(QByteArray* outFrame, QString* errMsg) const
     if (!tryBuildProfile(&p, errMsg))
         return false;
 
-    QByteArray frame(32, 0);
-
-    // Helper lambdas for encoding
-    auto putFloat = [&frame](int index0, double value) {
-        float f = static_cast<float>(value);
-        quint32 raw;
-        static_assert(sizeof(float) == sizeof(quint32), "float must be 4 bytes");
-        memcpy(&raw, &f, sizeof(float));
-        // Little-endian byte order
-        frame[index0 + 0] = char(raw & 0xFF);
-        frame[index0 + 1] = char((raw >> 8) & 0xFF);
-        frame[index0 + 2] = char((raw >> 16) & 0xFF);
-        frame[index0 + 3] = char((raw >> 24) & 0xFF);
-    };
-
-    auto putU16 = [&frame](int index0, int value) {
-        quint16 u = quint16(value);
-        // Little-endian byte order
-        frame[index0 + 0] = char(u & 0xFF);
-        frame[index0 + 1] = char((u >> 8) & 0xFF);
-    };
-
-    // Build the frame (0-indexed)
-    frame[0] = 0;                           // Byte 1: Reserved/Header
-    frame[1] = 1;                           // Byte 2: Command (1 = SET_PARAM)
-    frame[2] = char(modeToCode(p.mode));    // Byte 3: Mode code
-    frame[3] = char(p.lrl.value_or(60));    // Byte 4: LRL
-    frame[4] = char(p.url.value_or(120));   // Byte 5: URL
-
-    // Bytes 6-9: Atrial Amplitude (float)
-    putFloat(5, p.aAmp.value_or(3.5));
-
-    // Bytes 10-13: Ventricular Amplitude (float)
-    putFloat(9, p.vAmp.value_or(3.5));
-
-    // Bytes 14-17: Atrial Pulse Width (float)
-    putFloat(13, p.aPw.value_or(0.4));
-
-    // Bytes 18-21: Ventricular Pulse Width (float)
-    putFloat(17, p.vPw.value_or(0.4));
-
-    // Bytes 22-23: VRP (uint16)
-    putU16(21, p.vrp.value_or(320));
-
-    // Bytes 24-25: ARP (uint16)
-    putU16(23, p.arp.value_or(250));
-
-    // Bytes 26-32: Reserved/unused parameters (all zeros)
-    frame[25] = 0;      // Byte 26: HysteresisTime
-    putU16(26, 0);      // Bytes 27-28: AVD
-    frame[28] = 0;      // Byte 29: ReactionTime
-    frame[29] = 0;      // Byte 30: ResponseFactor
-    frame[30] = 0;      // Byte 31: RecoveryTime
-    frame[31] = 0;      // Byte 32: Unused
-
-    *outFrame = frame;
+    // Layout comes from framelayout.h, shared with PacemakerLink.
+    FrameLayout::Frame frame;
+    FrameLayout::put<FrameLayout::Type>(frame.data(), FrameLayout::MSG_SET_PARAMS);
+    FrameLayout::encodeParameters(p, frame.data());
+
+    *outFrame = QByteArray(frame.constData(), FrameLayout::FRAME_SIZE);
     if (errMsg) errMsg->clear();
 
     return true;
@@ -572,66 +484,36 @@ bool ParameterForm::buildTxFrame(QByteArray* outFrame, QString* errMsg) const
 
 bool ParameterForm::applyFromRxFrame(const QByteArray& frame, QString* errMsg)
 {
-    if (frame.size() < 32) {
+    if (frame.size() < FrameLayout::FRAME_SIZE) {
         if (errMsg) *errMsg = "Frame too short (expected 32 bytes).";
         return false;
     }
 
-    // Helper lambdas for decoding
-    auto getFloat = [&frame](int index0) -> double {
-        quint32 raw = 0;
-        raw |= (quint8(frame[index0 + 0]) << 0);
-        raw |= (quint8(frame[index0 + 1]) << 8);
-        raw |= (quint8(frame[index0 + 2]) << 16);
-        raw |= (quint8(frame[index0 + 3]) << 24);
-        float f;
-        memcpy(&f, &raw, sizeof(float));
-        return double(f);
-    };
-
-    auto getU16 = [&frame](int index0) -> int {
-        quint16 u = 0;
-        u |= quint8(frame[index0 + 0]);
-        u |= quint8(frame[index0 + 1]) << 8;
-        return int(u);
-    };
-
-    // Parse the frame
-    const quint8 modeCode = quint8(frame[2]);
-    const int lrl = quint8(frame[3]);
-    const int url = quint8(frame[4]);
-
-    const double aAmp = getFloat(5);
-    const double vAmp = getFloat(9);
-    const double aPw  = getFloat(13);
-    const double vPw  = getFloat(17);
-
-    const int vrp = getU16(21);
-    const int arp = getU16(23);
+    const Database::ModeProfile p =
+        FrameLayout::decodeParameters(reinterpret_cast<const quint8*>(frame.constData()));
 
     // Update UI
-    const QString modeStr = codeToMode(modeCode);
-    int idx = ui->modeCombo->findText(modeStr);
+    int idx = ui->modeCombo->findText(p.mode);
     if (idx >= 0)
         ui->modeCombo->setCurrentIndex(idx);
 
-    ui->lrlSpin->setValue(lrl);
-    ui->urlSpin->setValue(url);
+    ui->lrlSpin->setValue(p.lrl.value_or(60));
+    ui->urlSpin->setValue(p.url.value_or(120));
 
-    ui->arpSpin->setValue(arp);
-    ui->vrpSpin->setValue(vrp);
+    ui->arpSpin->setValue(p.arp.value_or(250));
+    ui->vrpSpin->setValue(p.vrp.value_or(320));
 
-    ui->aAmpSpin->setValue(aAmp);
-    ui->aPwSpin->setValue(aPw);
-    ui->vAmpSpin->setValue(vAmp);
-    ui->vPwSpin->setValue(vPw);
+    ui->aAmpSpin->setValue(p.aAmp.value_or(3.5));
+    ui->aPwSpin->setValue(p.aPw.value_or(0.4));
+    ui->vAmpSpin->setValue(p.vAmp.value_or(3.5));
+    ui->vPwSpin->setValue(p.vPw.value_or(0.4));
 
     if (errMsg) errMsg->clear();
     reflectValidity();
     emit statusMessage("✓ Parameters loaded from device frame.");
 
-    qDebug() << "RX Frame - Mode:" << modeStr
-             << "LRL:" << lrl << "URL:" << url;
+    qDebug() << "RX Frame - Mode:" << p.mode
+             << "LRL:" << p.lrl.value_or(0) << "URL:" << p.url.value_or(0);
 
     return true;
 }
@@ -8,7 +8,7 @@
 
 #include "database.h"   // Database::ModeProfile
 
-class SerialManager;
+class PacemakerLink;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class ParameterForm; }
@@ -27,6 +27,10 @@ public:
     // Used by report builder to get "LRL: 60 ppm", etc.
     QMap<QString, QString> currentValuesAsText() const;
 
+    // Send/Stop go through the application's link; the form opens no port
+    // of its own. Must be set before either button is used.
+    void setLink(PacemakerLink* link);
+
     // === Frame encode/decode for serial link ===
     // Build the 32-byte frame that the Simulink model expects.
     bool buildTxFrame(QByteArray* outFrame, QString* errMsg = nullptr) const;
@@ -49,13 +53,12 @@ private slots:
     // Serial communication slots
     void onSend();
     void onStop();
-    void onSerialError(const QString& msg);
 
 private:
     Ui::ParameterForm* ui;
     int userId_;
     QSettings settings_;
-    SerialManager* serial_{nullptr};
+    PacemakerLink* link_{nullptr};
 
     bool validate(QString* err) const;
     void reflectValidity();
@@ -69,8 +72,4 @@ private:
     bool checkPulseWidth(double v, QString* why) const;
 
     void updateConnectionStatus();
-
-    // Helpers for frame encode/decode
-    static quint8 modeToCode(const QString& mode);
-    static QString codeToMode(quint8 code);
 };
@@ -0,0 +1,49 @@
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// -------------------------------------------------------------
+// Construction
+// -------------------------------------------------------------
+RingBuffer::RingBuffer(int capacity)
+{
+    quint32 cap = 1;
+    while (cap < static_cast<quint32>(qMax(capacity, 1)))
+        cap <<= 1;
+
+    m_data.resize(cap);
+    m_mask = cap - 1;
+}
+
+// -------------------------------------------------------------
+// Writer side
+// -------------------------------------------------------------
+quint8* RingBuffer::writePtr(int* len)
+{
+    const quint32 pos = m_tail & m_mask;
+    const int untilWrap = capacity() - static_cast<int>(pos);
+    *len = std::min(untilWrap, freeSpace());
+    return m_data.data() + pos;
+}
+
+// -------------------------------------------------------------
+// Reader side
+// -------------------------------------------------------------
+const quint8* RingBuffer::readPtr(int* len) const
+{
+    const quint32 pos = m_head & m_mask;
+    const int untilWrap = capacity() - static_cast<int>(pos);
+    *len = std::min(untilWrap, size());
+    return m_data.data() + pos;
+}
+
+void RingBuffer::peek(int offset, quint8* dst, int n) const
+{
+    const quint32 pos = (m_head + static_cast<quint32>(offset)) & m_mask;
+    const int first = std::min(n, capacity() - static_cast<int>(pos));
+
+    std::memcpy(dst, m_data.data() + pos, static_cast<size_t>(first));
+    if (first < n)
+        std::memcpy(dst + first, m_data.data(), static_cast<size_t>(n - first));
+}
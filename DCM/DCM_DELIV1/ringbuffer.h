@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QtGlobal>
+#include <vector>
+
+// Fixed-capacity byte ring used on the serial RX path.
+// Storage is allocated once in the constructor; after that reads and writes
+// only move the head/tail counters, so the hot path never touches the heap.
+class RingBuffer {
+public:
+    // Capacity is rounded up to the next power of two.
+    explicit RingBuffer(int capacity);
+
+    int  capacity() const  { return static_cast<int>(m_mask + 1); }
+    int  size() const      { return static_cast<int>(m_tail - m_head); }
+    int  freeSpace() const { return capacity() - size(); }
+    bool isEmpty() const   { return m_head == m_tail; }
+
+    // Writer side: contiguous free region at the tail, then commit what was filled.
+    quint8* writePtr(int* len);
+    void    commit(int n)  { m_tail += static_cast<quint32>(n); }
+
+    // Reader side: contiguous readable region at the head, then consume.
+    const quint8* readPtr(int* len) const;
+    void          consume(int n) { m_head += static_cast<quint32>(n); }
+
+    // Random access relative to the head (no bounds check beyond the mask).
+    quint8 at(int offset) const { return m_data[(m_head + static_cast<quint32>(offset)) & m_mask]; }
+
+    // Copy n bytes starting at offset from the head, handling the wrap point.
+    void peek(int offset, quint8* dst, int n) const;
+
+    void clear() { m_head = m_tail = 0; }
+
+private:
+    std::vector<quint8> m_data;
+    quint32 m_mask{0};
+
+    // Free-running counters; size is tail - head even across wrap-around.
+    quint32 m_head{0};
+    quint32 m_tail{0};
+};
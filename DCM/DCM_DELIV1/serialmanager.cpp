@@ -66,13 +66,17 @@ bool SerialManager::writeBytes(const QByteArray& data)
         return false;
     }
 
+    if (port_.bytesToWrite() + data.size() > maxBacklog()) {
+        emit errorOccurred("Transmit backlog full");
+        return false;
+    }
+
     qint64 written = port_.write(data);
     if (written == -1) {
         emit errorOccurred(port_.errorString());
         return false;
     }
 
-    port_.flush();
     return true;
 }
 
@@ -18,7 +18,11 @@ public:
 
     bool isOpen() const { return port_.isOpen(); }
 
+    // Queues data for the port's event-driven writer. Never blocks; fails
+    // once the untransmitted backlog would exceed maxBacklog().
     bool writeBytes(const QByteArray& data);
+    qint64 pendingBytes() const { return port_.bytesToWrite(); }
+    static qint64 maxBacklog() { return 4096; }
     QByteArray readBytes();
 
 signals:
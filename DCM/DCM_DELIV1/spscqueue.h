@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+// Lock-free single-producer/single-consumer queue of small trivially
+// copyable records. Same scheme as EgramBuffer (free-running indices on
+// separate cache lines, each side caching the other's), for the low-rate
+// side channels that travel next to the sample stream.
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to the next power of two.
+    explicit SpscQueue(int capacity)
+    {
+        quint32 cap = 1;
+        while (cap < static_cast<quint32>(qMax(capacity, 1)))
+            cap <<= 1;
+        m_items.resize(cap);
+        m_mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // ---- Producer thread ----
+    // False if the queue was full; the item is dropped and counted.
+    bool push(const T& item)
+    {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == m_mask + 1) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache == m_mask + 1) {
+                m_overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        m_items[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ---- Consumer thread ----
+    bool pop(T* out)
+    {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache)
+                return false;
+        }
+
+        *out = m_items[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ---- Any thread ----
+    quint64 overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int CACHE_LINE = 64;
+
+    std::vector<T> m_items;
+    quint32 m_mask{0};
+
+    alignas(CACHE_LINE) std::atomic<quint32> m_tail{0};
+    quint32                                  m_headCache{0};
+    std::atomic<quint64>                     m_overflows{0};
+
+    alignas(CACHE_LINE) std::atomic<quint32> m_head{0};
+    quint32                                  m_tailCache{0};
+};
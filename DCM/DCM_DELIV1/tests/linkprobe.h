@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QMetaObject>
+
+#include <cstring>
+
+#include "framelayout.h"
+#include "pacemakerlink.h"
+
+// The tests' way into PacemakerLink's private RX path: feed bytes as if the
+// port had read them, and run what the egram timer would, on the I/O thread.
+class PacemakerLinkProbe {
+public:
+    explicit PacemakerLinkProbe(PacemakerLink* link) : m_link(link) {}
+
+    // Runs fn on the link's I/O thread and waits for it.
+    template <typename F>
+    void onIoThread(F fn)
+    {
+        QMetaObject::invokeMethod(m_link->m_io, fn, Qt::BlockingQueuedConnection);
+    }
+
+    // What handleReadyRead does, with bytes from memory instead of the
+    // port. A partial egram block stays staged until flush() or notifyEgram().
+    void receive(const quint8* data, int n)
+    {
+        while (n > 0) {
+            int room = 0;
+            quint8* dst = m_link->m_rx.writePtr(&room);
+            const int k = qMin(room, n);
+            std::memcpy(dst, data, static_cast<size_t>(k));
+            m_link->m_rx.commit(k);
+            m_link->processIncomingBytes();
+            data += k;
+            n -= k;
+        }
+    }
+
+    // The staging flush and stats publish, without the signal.
+    void flush()
+    {
+        m_link->flushEgramStage();
+        m_link->publishStats();
+    }
+
+    // What the egram timer's timeout runs.
+    void notifyEgram() { m_link->notifyEgram(); }
+
+    static FrameLayout::Frame setParametersFrame(const Database::ModeProfile& p, quint8 seq)
+    {
+        return PacemakerLink::buildSetParametersFrame(p, seq);
+    }
+
+private:
+    PacemakerLink* m_link;
+};
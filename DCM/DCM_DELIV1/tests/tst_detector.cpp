@@ -0,0 +1,219 @@
+#include <QCoreApplication>
+
+#include <cstdio>
+#include <vector>
+
+#include "egramdetector.h"
+#include "framelayout.h"
+#include "linkprobe.h"
+#include "pacemakerlink.h"
+
+// Synthetic beats, encoded as packed egram frames at the wire's scale
+// (int16 µV), must come out of the detector as markers: once decoded by
+// hand into EgramDetector, once through the link's own RX path, where the
+// link's statistics must count them whether or not the queue is drained.
+
+namespace {
+constexpr int BEAT_MS = 800;       // 75 bpm at 1 kHz
+constexpr int BEATS = 4;
+constexpr int PACE_AT = 150;       // ventricular event, ms into the beat
+
+int g_failures = 0;
+
+void check(bool ok, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL: %s\n", what);
+        ++g_failures;
+    }
+}
+
+// Every beat: a 1.5 mV, 10 ms P wave at its start. Even beats are paced:
+// a 1 ms, 20 mV spike, then a 3 mV evoked response 40 ms later, inside
+// VRP. Odd beats conduct: the same R wave at PACE_AT, no spike. In µV.
+qint16 beatUv(int i, bool ventricle)
+{
+    if (i >= BEATS * BEAT_MS)         // padding in the last frame
+        return 0;
+    const int beat = i / BEAT_MS;
+    const int t = i % BEAT_MS;
+    if (!ventricle)
+        return t < 10 ? 1500 : 0;
+    const bool paced = beat % 2 == 0;
+    if (paced && t == PACE_AT)
+        return 20000;
+    const int r = paced ? PACE_AT + 40 : PACE_AT;
+    return t >= r && t < r + 10 ? 3000 : 0;
+}
+
+std::vector<FrameLayout::Frame> makeFrames()
+{
+    using namespace FrameLayout;
+    std::vector<Frame> frames;
+    for (int i = 0; i < BEATS * BEAT_MS; i += EgramPacked::PAIRS_PER_FRAME) {
+        Frame f;
+        put<Type>(f.data(), MSG_EGRAM_PACKED);
+        put<EgramPacked::Counter>(f.data(), static_cast<quint16>(i));
+        put<EgramPacked::Count>(f.data(), EgramPacked::PAIRS_PER_FRAME);
+        for (int k = 0; k < EgramPacked::PAIRS_PER_FRAME; ++k) {
+            EgramPacked::setSample(f.data(), 2 * k, beatUv(i + k, false));
+            EgramPacked::setSample(f.data(), 2 * k + 1, beatUv(i + k, true));
+        }
+        frames.push_back(f);
+    }
+    return frames;
+}
+
+Database::ModeProfile profile()
+{
+    Database::ModeProfile p;
+    p.aSens = 0.75;
+    p.vSens = 2.5;
+    p.arp = 250;
+    p.vrp = 320;
+    return p;
+}
+
+// One AS per beat at its start; VP on even beats, VS on odd ones, both at
+// PACE_AT. The evoked response and the spike's trailing edge fall in VRP.
+void checkMarkers(const std::vector<EgramMarker>& markers, const char* path)
+{
+    std::vector<EgramMarker> expected;
+    for (int b = 0; b < BEATS; ++b) {
+        EgramMarker a;
+        a.timeMs = static_cast<quint32>(b * BEAT_MS);
+        a.kind = EgramMarker::AtrialSense;
+        expected.push_back(a);
+
+        EgramMarker v;
+        v.timeMs = static_cast<quint32>(b * BEAT_MS + PACE_AT);
+        v.kind = b % 2 == 0 ? EgramMarker::VentricularPace : EgramMarker::VentricularSense;
+        expected.push_back(v);
+    }
+
+    bool same = markers.size() == expected.size();
+    for (size_t i = 0; same && i < markers.size(); ++i)
+        same = markers[i].timeMs == expected[i].timeMs && markers[i].kind == expected[i].kind;
+
+    char what[96];
+    std::snprintf(what, sizeof what, "%s: one AS per beat, VP/VS alternating", path);
+    check(same, what);
+    if (!same) {
+        for (const EgramMarker& m : markers)
+            std::printf("  got %u ms kind %d\n", m.timeMs, static_cast<int>(m.kind));
+    }
+
+    // 800 ms intervals once two ventricular events are in.
+    std::snprintf(what, sizeof what, "%s: ventricular markers carry 75 bpm", path);
+    check(markers.size() >= 4 && markers[3].rateBpm > 74.9f && markers[3].rateBpm < 75.1f, what);
+}
+}
+
+int main(int argc, char** argv)
+{
+    using namespace FrameLayout;
+
+    QCoreApplication app(argc, argv);
+    const std::vector<Frame> frames = makeFrames();
+
+    // Decoded by hand, at the scale handlePackedEgramFrame uses.
+    {
+        EgramDetector detector;
+        detector.configure(EgramDetector::fromProfile(profile()));
+
+        std::vector<EgramMarker> markers;
+        quint32 t[EgramPacked::PAIRS_PER_FRAME];
+        float a[EgramPacked::PAIRS_PER_FRAME];
+        float v[EgramPacked::PAIRS_PER_FRAME];
+        EgramMarker out[2 * EgramPacked::PAIRS_PER_FRAME];
+        for (const Frame& f : frames) {
+            const quint16 counter = get<EgramPacked::Counter>(f.data());
+            for (int k = 0; k < EgramPacked::PAIRS_PER_FRAME; ++k) {
+                t[k] = static_cast<quint32>(counter + k);
+                a[k] = EgramPacked::sample(f.data(), 2 * k) * EgramPacked::MV_PER_LSB;
+                v[k] = EgramPacked::sample(f.data(), 2 * k + 1) * EgramPacked::MV_PER_LSB;
+            }
+            const int n = detector.process(t, a, v, EgramPacked::PAIRS_PER_FRAME,
+                                           out, 2 * EgramPacked::PAIRS_PER_FRAME);
+            markers.insert(markers.end(), out, out + n);
+        }
+        checkMarkers(markers, "EgramDetector");
+    }
+
+    // Through the link, with no filters so the shapes are untouched.
+    {
+        PacemakerLink link;
+        link.setEgramFilters(0);
+        link.setDetectorProfile(profile());
+
+        PacemakerLinkProbe probe(&link);
+        probe.onIoThread([&]() {
+            for (const Frame& f : frames)
+                probe.receive(f.data(), FRAME_SIZE);
+            probe.flush();
+        });
+
+        // Before anything drains markerQueue().
+        const EgramStats stats = link.egramStats();
+        check(stats.atrial().sensed == BEATS && stats.atrial().paced == 0,
+              "PacemakerLink: egramStats counts every atrial sense");
+        check(stats.ventricular().paced == BEATS / 2 && stats.ventricular().sensed == BEATS / 2,
+              "PacemakerLink: egramStats splits ventricular paced/sensed");
+        check(stats.intervals() == BEATS - 1 && qRound(stats.meanBpm()) == 75,
+              "PacemakerLink: egramStats rate is 75 bpm");
+
+        std::vector<EgramMarker> markers;
+        EgramMarker m;
+        while (link.markerQueue()->pop(&m))
+            markers.push_back(m);
+        checkMarkers(markers, "PacemakerLink");
+    }
+
+    // A device that restarts its stream sends the counter back to 0; the
+    // link's timestamps must not follow it. The second run carries on
+    // straight after the first, padding included.
+    {
+        PacemakerLink link;
+        link.setEgramFilters(0);
+        link.setDetectorProfile(profile());
+
+        const quint32 run = static_cast<quint32>(frames.size()) * EgramPacked::PAIRS_PER_FRAME;
+        std::vector<quint32> times;
+        static quint32 t[4096];
+        static float a[4096];
+        static float v[4096];
+        PacemakerLinkProbe probe(&link);
+        probe.onIoThread([&]() {
+            for (int r = 0; r < 2; ++r) {
+                for (const Frame& f : frames)
+                    probe.receive(f.data(), FRAME_SIZE);
+                probe.flush();
+                const int n = link.egramQueue()->drain(t, a, v, 4096);
+                times.insert(times.end(), t, t + n);
+            }
+        });
+
+        bool ascending = times.size() == 2 * run;
+        for (size_t i = 1; ascending && i < times.size(); ++i)
+            ascending = times[i] == times[i - 1] + 1;
+        check(ascending, "PacemakerLink: timestamps keep ascending across a counter restart");
+        check(link.stats().egramLost == 0, "PacemakerLink: a counter restart is not counted as loss");
+
+        std::vector<EgramMarker> first, second;
+        EgramMarker m;
+        while (link.markerQueue()->pop(&m)) {
+            if (m.timeMs < run) {
+                first.push_back(m);
+            } else {
+                m.timeMs -= run;
+                second.push_back(m);
+            }
+        }
+        checkMarkers(first, "PacemakerLink, before restart");
+        checkMarkers(second, "PacemakerLink, after restart");
+    }
+
+    if (g_failures == 0)
+        std::printf("PASS\n");
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstring>
+
+#include "framelayout.h"
+#include "linkprobe.h"
+#include "pacemakerlink.h"
+
+// Raw framing must put every parameter exactly where the pacemaker's
+// serial receive chart reads it. The expected bytes below are written out
+// by hand from that chart, not derived from FrameLayout::FIELDS.
+
+namespace {
+int g_failures = 0;
+
+void check(bool ok, const char* what)
+{
+    if (!ok) {
+        std::printf("FAIL: %s\n", what);
+        ++g_failures;
+    }
+}
+
+void dump(const char* label, const quint8* f)
+{
+    std::printf("%-9s", label);
+    for (int i = 0; i < FrameLayout::FRAME_SIZE; ++i)
+        std::printf(" %02X", f[i]);
+    std::printf("\n");
+}
+
+Database::ModeProfile vviProfile()
+{
+    Database::ModeProfile p;
+    p.mode  = "VVI";
+    p.lrl   = 60;
+    p.url   = 120;
+    p.aAmp  = 3.5;
+    p.vAmp  = 3.5;
+    p.aPw   = 0.4;
+    p.vPw   = 0.4;
+    p.vrp   = 320;
+    p.arp   = 250;
+    p.aSens = 0.75;   // not on the wire
+    p.vSens = 2.5;
+    return p;
+}
+
+// rxdata(k) in the chart is byte k-1 here. The chart only leaves
+// WAIT_FRAME when rxdata(1) == 1 and drops the frame unless rxdata(2) == 0.
+constexpr quint8 EXPECTED[FrameLayout::FRAME_SIZE] = {
+    0x01,                    //  0     command: MSG_SET_PARAMS
+    0x00,                    //  1     must be 0 (Sync in SyncCrc)
+    0x04,                    //  2     Mode: VVI
+    60,                      //  3     LRL
+    120,                     //  4     URL (MSR)
+    0x00, 0x00, 0x60, 0x40,  //  5- 8 AAmp 3.5f
+    0x00, 0x00, 0x60, 0x40,  //  9-12 VAmp 3.5f
+    0xCD, 0xCC, 0xCC, 0x3E,  // 13-16 APW 0.4f
+    0xCD, 0xCC, 0xCC, 0x3E,  // 17-20 VPW 0.4f
+    0x40, 0x01,              // 21-22 VRP 320
+    0xFA, 0x00,              // 23-24 ARP 250
+    0x00,                    // 25    HysteresisTime
+    0x00, 0x00,              // 26-27 AVD
+    0x00,                    // 28    ReactionTime
+    0x00,                    // 29    ResponseFactor
+    0x00,                    // 30    RecoveryTime
+    0x00,                    // 31    not read by the firmware (Seq)
+};
+}
+
+int main()
+{
+    using namespace FrameLayout;
+
+    const Frame plain = PacemakerLinkProbe::setParametersFrame(vviProfile(), 0);
+    const bool same = std::memcmp(plain.data(), EXPECTED, FRAME_SIZE) == 0;
+    check(same, "Raw SET_PARAMS frame matches the firmware byte map");
+    if (!same) {
+        dump("expected", EXPECTED);
+        dump("actual", plain.data());
+    }
+
+    // A tracked request differs only in the byte the firmware ignores.
+    const Frame tracked = PacemakerLinkProbe::setParametersFrame(vviProfile(), 7);
+    check(std::memcmp(tracked.data(), EXPECTED, FRAME_SIZE - 1) == 0,
+          "Seq leaves the firmware's bytes untouched");
+    check(tracked.bytes[FRAME_SIZE - 1] == 7, "Seq is carried in byte 31");
+
+    const Database::ModeProfile back = decodeParameters(plain.data());
+    check(back.mode == "VVI" && back.lrl == 60 && back.url == 120
+          && back.vrp == 320 && back.arp == 250,
+          "decodeParameters reads back what encodeParameters wrote");
+    check(!back.aSens && !back.vSens, "sensitivity is not carried on the wire");
+
+    if (g_failures == 0)
+        std::printf("PASS\n");
+    return g_failures == 0 ? 0 : 1;
+}
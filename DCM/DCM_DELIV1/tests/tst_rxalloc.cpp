@@ -0,0 +1,171 @@
+#include <QCoreApplication>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "egramdsp.h"
+#include "framelayout.h"
+#include "linkprobe.h"
+#include "pacemakerlink.h"
+
+// The steady-state RX path (ring -> frame decode -> staging -> filters ->
+// detector -> egram and marker queues) must not touch the heap. Every
+// operator new on the link's I/O thread is counted while a few seconds of
+// packed and one-pair egram traffic go through it, in serial-sized reads
+// with the egram timer's work (notifyEgram: partial-block flush, stats
+// publish, egramDataAvailable) after each one.
+//
+// Not covered: the I/O thread's event loop itself. The reads and the
+// notifications are called directly inside one blocking call, so the
+// egram timer's restart and timeout dispatch and the queued delivery of
+// egramDataAvailable to a connected receiver are left to Qt; here the
+// signal has no receivers.
+
+// -------------------------------------------------------------
+// Counting allocator
+// -------------------------------------------------------------
+namespace {
+thread_local bool t_counting = false;
+std::atomic<int>  g_allocations{0};
+
+void* countedAlloc(std::size_t n, std::size_t align)
+{
+    if (t_counting)
+        ++g_allocations;
+
+    n = n ? n : 1;
+    void* p = align <= alignof(std::max_align_t)
+        ? std::malloc(n)
+        : std::aligned_alloc(align, (n + align - 1) / align * align);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+}
+
+void* operator new(std::size_t n) { return countedAlloc(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a) { return countedAlloc(n, static_cast<std::size_t>(a)); }
+void  operator delete(void* p) noexcept { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void  operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// -------------------------------------------------------------
+// Traffic
+// -------------------------------------------------------------
+namespace {
+constexpr int RATE_HZ = 1000;
+constexpr int BEAT_MS = 800;
+constexpr int READ_CHUNK = 160;      // five packed frames: one 40 ms egram tick at 1 kHz
+
+// A 75 bpm beat: a 1 ms pacing step and a few ms of R wave, in µV.
+qint16 beatUv(quint64 i, bool ventricle)
+{
+    const int t = static_cast<int>(i % (RATE_HZ * BEAT_MS / 1000));
+    const int at = ventricle ? 150 : 0;
+    if (t == at)
+        return 20000;
+    if (t > at + 40 && t < at + 50)
+        return static_cast<qint16>(ventricle ? 3000 : 1500);
+    return 0;
+}
+
+// seconds of packed frames, with every sixteenth frame sent as a one-pair
+// frame instead, starting at sample index first.
+std::vector<quint8> makeTraffic(quint64 first, int seconds)
+{
+    using namespace FrameLayout;
+    std::vector<quint8> out;
+    quint64 i = first;
+    for (int frame = 0; i < first + static_cast<quint64>(seconds) * RATE_HZ; ++frame) {
+        Frame f;
+        if (frame % 16 == 15) {
+            put<Type>(f.data(), MSG_EGRAM_SAMPLES);
+            put<Egram::Time>(f.data(), static_cast<quint32>(i * 1000 / RATE_HZ));
+            put<Egram::Atrial>(f.data(), beatUv(i, false) * EgramPacked::MV_PER_LSB);
+            put<Egram::Ventricular>(f.data(), beatUv(i, true) * EgramPacked::MV_PER_LSB);
+            // The packed counter continues past it, so it reads as one lost sample.
+            i += 1;
+        } else {
+            put<Type>(f.data(), MSG_EGRAM_PACKED);
+            put<EgramPacked::Counter>(f.data(), static_cast<quint16>(i));
+            put<EgramPacked::Count>(f.data(), EgramPacked::PAIRS_PER_FRAME);
+            for (int k = 0; k < EgramPacked::PAIRS_PER_FRAME; ++k) {
+                EgramPacked::setSample(f.data(), 2 * k, beatUv(i + k, false));
+                EgramPacked::setSample(f.data(), 2 * k + 1, beatUv(i + k, true));
+            }
+            i += EgramPacked::PAIRS_PER_FRAME;
+        }
+        out.insert(out.end(), f.bytes.begin(), f.bytes.end());
+    }
+    return out;
+}
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    PacemakerLink link;
+    link.setEgramFilters(EgramDsp::BaselineRemoval | EgramDsp::BandPass | EgramDsp::Notch60);
+
+    Database::ModeProfile profile;
+    profile.aSens = 1.0;
+    profile.vSens = 2.5;
+    profile.arp = 250;
+    profile.vrp = 320;
+    link.setDetectorProfile(profile);
+
+    const std::vector<quint8> warmUp = makeTraffic(0, 2);
+    const std::vector<quint8> steady = makeTraffic(2 * RATE_HZ, 10);
+
+    // The renderer's side, drained between reads like the widget would.
+    static quint32 t[4096];
+    static float a[4096];
+    static float v[4096];
+    quint64 drained = 0;
+    quint64 markers = 0;
+    auto drain = [&]() {
+        drained += static_cast<quint64>(link.egramQueue()->drain(t, a, v, 4096));
+        EgramMarker m;
+        while (link.markerQueue()->pop(&m))
+            ++markers;
+    };
+
+    PacemakerLinkProbe probe(&link);
+    auto feed = [&](const std::vector<quint8>& bytes) {
+        for (size_t pos = 0; pos < bytes.size(); pos += READ_CHUNK) {
+            probe.receive(bytes.data() + pos, static_cast<int>(qMin<size_t>(READ_CHUNK, bytes.size() - pos)));
+            probe.notifyEgram();
+            drain();
+        }
+    };
+    probe.onIoThread([&]() {
+        feed(warmUp);
+
+        drained = 0;
+        markers = 0;
+        t_counting = true;
+        feed(steady);
+        t_counting = false;
+    });
+
+    std::printf("%zu bytes, %llu samples drained, %llu markers, %d allocations\n",
+                steady.size(), static_cast<unsigned long long>(drained),
+                static_cast<unsigned long long>(markers), g_allocations.load());
+
+    if (drained == 0) {
+        std::printf("FAIL: no samples reached the egram queue\n");
+        return 1;
+    }
+    if (g_allocations.load() != 0) {
+        std::printf("FAIL: the steady-state RX path allocated\n");
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}